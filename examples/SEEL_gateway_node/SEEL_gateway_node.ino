@@ -20,13 +20,14 @@ constexpr uint8_t SEEL_RNG_SEED_PIN = 0; // Make sure this pin is NOT connected
 
 /* File Write Paramters */
 const char* LOG_FILE_PATH = ""; // Path on gateway node file system
+constexpr uint8_t LOG_LINE_SIZE = 4 + 4 * SEEL_MSG_DATA_SIZE + 1; // Longest logged line ("BD: " and up to 4 chars per data byte) plus terminator
 
 /* SEEL Variables */
 SEEL_Scheduler seel_scheduler;
 SEEL_GNode seel_gnode;
 
 // Example function on how to write strings to file (must have capable hardware setup)
-void write_to_file(const String& to_write)
+void write_to_file(const char* to_write)
 {
   // Append setting adds on, instead of clearing all previous lines in log
   File f = FileSystem.open(LOG_FILE_PATH, FILE_APPEND);
@@ -57,22 +58,19 @@ void user_callback_broadcast(uint8_t msg_data[SEEL_MSG_DATA_SIZE], uint16_t prev
 {
   // The contents of this function are an example of what one can do with this CB function
   
-  String msg_string = "";
-  msg_string = F("BT: "); // Broadcast Time
-  msg_string += String(millis(), DEC) + F("\n");
-  msg_string += F("PT: "); // Previous Transmissions (any type) sent
-  msg_string += String(prev_any_trans, DEC);
-  write_to_file(msg_string);
+  // Lines are assembled in a fixed buffer, String would allocate on the heap for every piece
+  SEEL_Print_Line_Storage<LOG_LINE_SIZE> msg_string;
+  msg_string.add(F("BT: ")); // Broadcast Time
+  msg_string.add_dec(millis()).add('\n');
+  msg_string.add(F("PT: ")); // Previous Transmissions (any type) sent
+  msg_string.add_dec(prev_any_trans);
+  write_to_file(msg_string.c_str());
   
-  msg_string = "";
-  msg_string += F("BD: "); // Broadcast Data
-  for (uint32_t i = 0; i < SEEL_MSG_DATA_SIZE; ++i)
-  {
-    String msg_data_str = String(msg_data[i], DEC) + F(" ");
-    msg_string += msg_data_str;
-  }
+  msg_string.clear();
+  msg_string.add(F("BD: ")); // Broadcast Data
+  msg_string.add_bytes(msg_data, SEEL_MSG_DATA_SIZE);
 
-  write_to_file(msg_string);
+  write_to_file(msg_string.c_str());
 }
 
 // This callback function is called when the GNODE receives a data message
@@ -82,27 +80,26 @@ void user_callback_data(const uint8_t msg_data[SEEL_MSG_DATA_SIZE], const int8_t
 {
   // The contents of this function are an example of what one can do with this CB function
   
-  String msg_string = "";
+  SEEL_Print_Line_Storage<LOG_LINE_SIZE> msg_string;
   
   for (uint32_t i = 0; i < SEEL_MSG_DATA_SIZE; ++i)
   {
-    String msg_data_str = String(msg_data[i], DEC) + F(" ");
-    String index_str = "";
     uint8_t field_value = msg_data[i];
     // Record GNODE reception RSSI if GNODE is first parent
     if (i == 3 && msg_data[2] == SEEL_GNODE_ID) // Corresponds to message locations hard-coded in the SNODE .ino file
     {
       field_value = msg_rssi;
     }
-    msg_string += msg_data_str;
-    index_str += F("[");
-    index_str += String(i, DEC);
-    index_str += F("]");
-    SEEL_Print::print(index_str + msg_data_str);
+    msg_string.add_dec(msg_data[i]).add(' ');
+    SEEL_Print::print('[');
+    SEEL_Print::print(i);
+    SEEL_Print::print(']');
+    SEEL_Print::print(msg_data[i]);
+    SEEL_Print::print(' ');
   }
   SEEL_Print::println("");
 
-  write_to_file(msg_string);
+  write_to_file(msg_string.c_str());
 }
 
 void setup()
@@ -16,10 +16,11 @@ SEEL_SNode seel_snode;
 
 /* USER Variables */
 SEEL_Task user_task;
+SEEL_Scheduler::SEEL_Task_Handle user_task_handle;
 uint16_t send_count;
 bool send_ready;
 
-void print_task_info(String msg)
+void print_task_info(const __FlashStringHelper* msg)
 {
   uint32_t task_time_to_run;
   uint32_t task_delay;
@@ -27,7 +28,7 @@ void print_task_info(String msg)
   if (seel_sched.get_task_info(&task_time_to_run, &task_delay, &task_id))
   {
     SEEL_Print::println(msg);
-    SEEL_Print::print(F("\tTask Start Time: ")); SEEL_Print::println(task_time_to_run); // Users can use the time_to_run variable to schedule periodic events
+    SEEL_Print::print(F("\tTask Start Time: ")); SEEL_Print::println(task_time_to_run); // Users can use the time_to_run variable to schedule follow-up events; see add_periodic_task() for periodic events
     SEEL_Print::print(F("\tTask Delay: ")); SEEL_Print::println(task_delay);
     SEEL_Print::print(F("\tTask ID: ")); SEEL_Print::println(task_id);
   }
@@ -51,7 +52,11 @@ bool user_callback_load(uint8_t msg_data[SEEL_MSG_DATA_SIZE], SEEL_Node::SEEL_CB
 
   if (info->first_callback)
   {
-    seel_sched.add_task(&user_task);
+    // User tasks are kept across sleep, so only add the task if the previous one has run
+    if (!seel_sched.task_active(user_task_handle))
+    {
+      user_task_handle = seel_sched.add_task(&user_task);
+    }
     send_ready = false;
 
     return false;
@@ -0,0 +1,114 @@
+# Converts logs captured with deferred logging (SEEL_LOG_DEFERRED_ENABLE in "SEEL_Params.h") back into the text format
+# printed without it, so the output can be read by "SEEL_log_parser.py"
+
+# Tested with Python 3.6.0
+
+# To run: python3 <path_to_this_file>/SEEL_log_decoder.py <raw capture file> <decoded output file> (optional)<SEEL_MSG_USER_SIZE>
+
+# The capture must hold the raw bytes written by the NODE (e.g. a binary serial capture). Text output is copied as is;
+# binary records start with RECORD_MARK, followed by an event ID and a fixed size payload (multi-byte values big endian)
+# Make sure the "Record Section" in this script matches that in "SEEL_Print.h"
+
+import sys
+
+################################################################################
+# Record Section
+RECORD_MARK = 0xA5
+EVENT_DROPPED = 0
+EVENT_SEND = 1
+EVENT_RECEIVE = 2
+RX_DUPLICATE = 1
+RX_WRONG_LENGTH = 2
+
+MSG_BASE_SIZE = 23 # Header and misc bytes, user bytes are added to this
+MSG_USER_SIZE = 4 # Default SEEL_MSG_USER_SIZE
+
+NEWLINE = "\r\n" # Arduino println() line ending
+
+def read_uint(data, index, size):
+    value = 0
+    for i in range(size):
+        value = (value << 8) | data[index + i]
+    return value
+
+def read_int8(data, index):
+    value = data[index]
+    return value - 256 if value > 127 else value
+
+def format_msg(data, index, msg_size):
+    return "".join(str(b) + " " for b in data[index:index + msg_size])
+
+# Returns (text, record size including the mark) for the record at "index", or (None, 1) if the record is unknown or cut off
+def decode_record(data, index, msg_size):
+    if index + 1 >= len(data):
+        return None, 1
+    event = data[index + 1]
+    body = index + 2
+
+    if event == EVENT_DROPPED:
+        size = 2 + 2
+        if index + size > len(data):
+            return None, 1
+        return "Log dropped: " + str(read_uint(data, body, 2)) + " bytes" + NEWLINE, size
+
+    if event == EVENT_SEND:
+        size = 2 + msg_size + 8
+        if index + size > len(data):
+            return None, 1
+        text = "<<S: " + format_msg(data, body, msg_size)
+        text += ", Start Time: " + str(read_uint(data, body + msg_size, 4))
+        text += ", ToA: " + str(read_uint(data, body + msg_size + 4, 4)) + NEWLINE
+        return text, size
+
+    if event == EVENT_RECEIVE:
+        size = 2 + 1 + msg_size + 7
+        if index + size > len(data):
+            return None, 1
+        status = data[body]
+        text = ">>R: "
+        if status == RX_DUPLICATE:
+            text += "Duplicate message" + NEWLINE
+        elif status == RX_WRONG_LENGTH:
+            text += "Wrong length message" + NEWLINE
+        tail = body + 1 + msg_size
+        text += format_msg(data, body + 1, msg_size)
+        text += "Len: " + str(data[tail])
+        text += ", SNR: " + "{:.2f}".format(read_int8(data, tail + 1) / 4.0)
+        text += ", RSSI: " + str(read_int8(data, tail + 2))
+        text += ", Rec. Time: " + str(read_uint(data, tail + 3, 4)) + NEWLINE
+        return text, size
+
+    return None, 1
+
+def decode(data, msg_size):
+    out = []
+    text_start = 0
+    index = 0
+    while index < len(data):
+        if data[index] != RECORD_MARK:
+            index += 1
+            continue
+        text, size = decode_record(data, index, msg_size)
+        if text is None:
+            index += 1 # Not a record, keep the byte as text
+            continue
+        out.append(data[text_start:index].decode("ascii", errors="replace"))
+        out.append(text)
+        index += size
+        text_start = index
+    out.append(data[text_start:].decode("ascii", errors="replace"))
+    return "".join(out)
+
+def main():
+    if len(sys.argv) < 3:
+        print("Usage: python3 SEEL_log_decoder.py <raw capture file> <decoded output file> (optional)<SEEL_MSG_USER_SIZE>")
+        sys.exit(1)
+    user_size = int(sys.argv[3]) if len(sys.argv) > 3 else MSG_USER_SIZE
+
+    with open(sys.argv[1], "rb") as capture:
+        data = capture.read()
+    with open(sys.argv[2], "w", newline="") as decoded:
+        decoded.write(decode(data, MSG_BASE_SIZE + user_size))
+
+if __name__ == "__main__":
+    main()
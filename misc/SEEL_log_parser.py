@@ -11,13 +11,14 @@
 # Requires installation of seaborn: "pip3 install seaborn"
 
 # To run: python3 <path_to_this_file>/SEEL_log_parser.py <path_to_data_file>/<data_file> (optional)<path to param file>/<param file>
+# Logs captured with deferred logging (SEEL_LOG_DEFERRED_ENABLE) must first be converted with SEEL_log_decoder.py
 
 # Expected input format (All <> is 1 byte):
 # Broadcast time: "BT: <time>"
 # Broadcast data: "BD: <INDEX BCAST 0> <INDEX BCAST 1> ....
 # Node data: <INDEX DATA 0> <INDEX DATA 1> ....
 
-# Make sure the "Indexes Section" in this script matches that in "SEEL_Defines.h" and "SEEL_sensor_node.ino"
+# Make sure the "Indexes Section" in this script matches that in "SEEL_Wire.h" and "SEEL_sensor_node.ino"
 
 # Use the deployment info file argument to override default parser parameters. See the "External Variables Section" for more info.
 
@@ -0,0 +1,92 @@
+/*
+The SEEL repository can be found at: https://github.com/SEEL-Group/SEEL
+Copyright (C) SEEL Group 2021 all rights reserved
+See license file in root folder for more licensing details
+See SEEL_documentation.pdf for protocol description details
+
+File purpose:   Header-only host library to decode logged SEEL msgs with the NODEs' wire layouts (src/SEEL_Wire.h)
+*/
+
+#ifndef SEEL_Wire_Host_h
+#define SEEL_Wire_Host_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+Usage: #include "SEEL_Wire_Host.h", compile with -std=c++11 or later (-O2 or higher for batch decoding)
+Define SEEL_HOST_MSG_USER_SIZE to the SEEL_MSG_USER_SIZE of the deployment before including (default 4)
+
+Frames are full msgs (SEEL_MSG_TOTAL_SIZE bytes each) stored back to back, data-section fields
+(SEEL_Wire_Bcast, SEEL_Wire_ID_Check, ...) are decoded from the frame's data section
+
+Example, decode the network time of every logged bcast:
+    seel_host_decode_data<SEEL_Wire_Bcast::Time_Sync>(frames, frame_count, times);
+*/
+
+#ifndef SEEL_HOST_MSG_USER_SIZE
+#define SEEL_HOST_MSG_USER_SIZE 4
+#endif
+
+constexpr uint32_t SEEL_MSG_USER_SIZE = SEEL_HOST_MSG_USER_SIZE;
+
+#include "../../src/SEEL_Wire.h"
+
+// Decodes "Field" (offset by "BASE" bytes) from "count" frames into "out"
+// The frame stride and field position are compile-time constants and the byte loads are unrolled,
+// so the loop has no data dependent branches and can be vectorised by the compiler
+template <typename Field, uint8_t BASE = 0>
+inline void seel_host_decode(const uint8_t* __restrict frames, size_t count, uint32_t* __restrict out)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        out[i] = Field::get(frames + i * SEEL_MSG_TOTAL_SIZE + BASE);
+    }
+}
+
+// Decodes a data-section field, e.g. SEEL_Wire_Bcast::Time_Sync, from "count" frames into "out"
+template <typename Field>
+inline void seel_host_decode_data(const uint8_t* __restrict frames, size_t count, uint32_t* __restrict out)
+{
+    seel_host_decode<Field, SEEL_Wire_Msg::Data::index>(frames, count, out);
+}
+
+// Copies the indices of frames with command "cmd" into "out", returns how many were found
+// "out" must hold "count" entries: the loop is branchless and writes a slot for every frame, not just for matches
+inline size_t seel_host_select_cmd(const uint8_t* frames, size_t count, uint8_t cmd, size_t* out)
+{
+    size_t found = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        out[found] = i;
+        found += (SEEL_Wire_Msg::Cmd::get(frames + i * SEEL_MSG_TOTAL_SIZE) == cmd);
+    }
+    return found;
+}
+
+// Parses up to "max_bytes" space separated decimal bytes of a log line into "out", stops at the first non-digit
+// that is not a space. Returns the number of bytes parsed, a full frame is SEEL_MSG_TOTAL_SIZE bytes
+inline size_t seel_host_parse_bytes(const char* line, uint8_t* out, size_t max_bytes)
+{
+    size_t parsed = 0;
+    while (parsed < max_bytes)
+    {
+        while (*line == ' ')
+        {
+            ++line;
+        }
+        if (*line < '0' || *line > '9')
+        {
+            break;
+        }
+        uint32_t value = 0;
+        while (*line >= '0' && *line <= '9')
+        {
+            value = value * 10 + (uint32_t) (*line++ - '0');
+        }
+        out[parsed++] = (uint8_t) value;
+    }
+    return parsed;
+}
+
+#endif // SEEL_Wire_Host_h
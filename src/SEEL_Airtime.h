@@ -0,0 +1,67 @@
+/*
+The SEEL repository can be found at: https://github.com/SEEL-Group/SEEL
+Copyright (C) SEEL Group 2021 all rights reserved
+See license file in root folder for more licensing details
+See SEEL_documentation.pdf for protocol description details
+
+File purpose:   Compile-time LoRa time-on-air model, used to size TDMA slots and timeouts in SEEL_Params.h
+*/
+
+#ifndef SEEL_Airtime_h
+#define SEEL_Airtime_h
+
+#include <stdint.h>
+
+// Semtech SX1276 datasheet (section 4.1.1.7) time-on-air formula
+// "sf": spreading factor (6 to 12), "bw": bandwidth in Hz, "cr": coding rate denominator (5 to 8, i.e. 4/5 to 4/8)
+// "preamble": programmed preamble length in symbols, "pl": payload length in bytes
+// All functions are constexpr so results can size other constants; they are not meant to be called at run time
+
+// Low data rate optimization is required (and set by the LoRa library) once a symbol lasts longer than 16 ms
+constexpr bool seel_airtime_ldro(uint8_t sf, uint32_t bw)
+{
+    return ((uint64_t) 1 << sf) * 1000 > (uint64_t) 16 * bw;
+}
+
+// Ceiling division of a possibly negative numerator, negative results clamp to 0
+constexpr int32_t seel_airtime_ceil_div(int32_t num, int32_t den)
+{
+    return (num <= 0) ? 0 : (num + den - 1) / den;
+}
+
+// Number of payload symbols, including the 8 symbols sent at coding rate 4/8 with the explicit header
+constexpr uint32_t seel_airtime_payload_symbols(uint8_t pl, uint8_t sf, uint8_t cr, bool crc, bool implicit_header, bool ldro)
+{
+    return 8 + seel_airtime_ceil_div(8 * (int32_t) pl - 4 * (int32_t) sf + 28 + 16 * crc - 20 * implicit_header,
+        4 * ((int32_t) sf - 2 * ldro)) * cr;
+}
+
+// Time on air in microseconds, symbols are counted in quarters since the preamble adds 4.25 symbols
+constexpr uint32_t seel_airtime_micros(uint8_t pl, uint8_t sf, uint32_t bw, uint8_t cr, uint16_t preamble,
+    bool crc, bool implicit_header)
+{
+    return (uint32_t) (((uint64_t) (4 * (uint32_t) preamble + 17)
+        + 4 * (uint64_t) seel_airtime_payload_symbols(pl, sf, cr, crc, implicit_header, seel_airtime_ldro(sf, bw)))
+        * ((uint64_t) 1 << sf) * 1000000 / (4 * (uint64_t) bw));
+}
+
+// Symbol duration in microseconds, rounded down
+constexpr uint32_t seel_airtime_symbol_micros(uint8_t sf, uint32_t bw)
+{
+    return (uint32_t) (((uint64_t) 1 << sf) * 1000000 / bw);
+}
+
+// Preamble length in symbols that stays on air for at least "millis" longer than a "preamble" symbol preamble
+constexpr uint32_t seel_airtime_preamble_covering(uint32_t millis, uint8_t sf, uint32_t bw, uint16_t preamble)
+{
+    return preamble + (millis * 1000 + seel_airtime_symbol_micros(sf, bw) - 1) / seel_airtime_symbol_micros(sf, bw);
+}
+
+// Time on air in milliseconds, rounded up
+constexpr uint32_t seel_airtime_millis(uint8_t pl, uint8_t sf, uint32_t bw, uint8_t cr, uint16_t preamble,
+    bool crc, bool implicit_header)
+{
+    return (seel_airtime_micros(pl, sf, bw, cr, preamble, crc, implicit_header) + 999) / 1000;
+}
+
+#endif // SEEL_Airtime_h
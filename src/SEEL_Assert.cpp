@@ -145,19 +145,19 @@ void SEEL_Assert::print_nvm_fails_helper()
                     break;
                 case 3:
                     line_num += val;
-                    String assert_fail_str = "";
+                    SEEL_Print_Line_Storage<64> assert_fail_str;
                     if (prev_valid_entry)
                     {
-                        assert_fail_str += F("PRINT ASSERT FAIL: File ");
+                        assert_fail_str.add(F("PRINT ASSERT FAIL: File "));
                     }
                     else
                     {
-                        assert_fail_str += F("PRINT ASSERT FAIL (Maybe Dummy Head): File "); // maybe since it could be a starting block and wraparound expensive to check
+                        assert_fail_str.add(F("PRINT ASSERT FAIL (Maybe Dummy Head): File ")); // maybe since it could be a starting block and wraparound expensive to check
                     }
-                    assert_fail_str += String(file_num);
-                    assert_fail_str += F(", Line ");
-                    assert_fail_str += String(line_num);
-                    SEEL_Print::println(assert_fail_str);
+                    assert_fail_str.add_dec(file_num);
+                    assert_fail_str.add(F(", Line "));
+                    assert_fail_str.add_dec(line_num);
+                    SEEL_Print::println(assert_fail_str.c_str());
                     prev_valid_entry = true;
                     break;
                 default:
@@ -201,6 +201,7 @@ void SEEL_Assert::assert_helper(bool test, uint16_t file_num, uint16_t line_num,
     // Print assert failure
     SEEL_Print::print(F("ASSERT FAIL: File ")); SEEL_Print::print(file_num);
     SEEL_Print::print(F(", Line ")); SEEL_Print::println(line_num);
+    SEEL_Print::drain(true);
 
     // Add error to assert queue
     uint32_t error = 0;
@@ -0,0 +1,249 @@
+/*
+The SEEL repository can be found at: https://github.com/SEEL-Group/SEEL
+Copyright (C) SEEL Group 2021 all rights reserved
+See license file in root folder for more licensing details
+See SEEL_documentation.pdf for protocol description details
+
+File purpose:   See SEEL_Data_Queue.h
+*/
+
+#include "SEEL_Data_Queue.h"
+
+SEEL_Data_Queue::SEEL_Data_Queue(SEEL_Msg_Pool* msg_pool) : _msg_pool_ptr(msg_pool), _size(0)
+{
+    for (uint8_t i = 0; i < SEEL_SNODE_MSG_QUEUE_SIZE; ++i)
+    {
+        _class[i] = MSG_CLASS_NONE;
+    }
+    clear();
+}
+
+void SEEL_Data_Queue::clear()
+{
+    while (_size > 0)
+    {
+        remove(_order[0]);
+    }
+    _head = SEEL_DQ_NO_SLOT;
+    _last_class = MSG_CLASS_NONE;
+    _last_fwd_src = 0;
+}
+
+SEEL_Msg_Handle SEEL_Data_Queue::front_handle()
+{
+    if (_head == SEEL_DQ_NO_SLOT)
+    {
+        _head = select();
+    }
+    return (_head == SEEL_DQ_NO_SLOT) ? SEEL_MSG_NO_HANDLE : _handles[_head];
+}
+
+SEEL_Message* SEEL_Data_Queue::front()
+{
+    SEEL_Msg_Handle handle = front_handle();
+    return (handle == SEEL_MSG_NO_HANDLE) ? NULL : _msg_pool_ptr->get(handle);
+}
+
+bool SEEL_Data_Queue::front_own()
+{
+    return front_handle() != SEEL_MSG_NO_HANDLE && _own[_head];
+}
+
+void SEEL_Data_Queue::pop_front()
+{
+    if (front_handle() != SEEL_MSG_NO_HANDLE)
+    {
+        remove(_head);
+    }
+}
+
+bool SEEL_Data_Queue::make_room(SEEL_Msg_Class msg_class, uint8_t src, SEEL_Msg_Class* evicted)
+{
+    *evicted = MSG_CLASS_NONE;
+    if (_size < SEEL_SNODE_MSG_QUEUE_SIZE)
+    {
+        return true;
+    }
+
+    uint8_t victim = select_victim(msg_class, src);
+    if (victim == SEEL_DQ_NO_SLOT)
+    {
+        return false;
+    }
+    *evicted = (SEEL_Msg_Class) _class[victim];
+    remove(victim);
+    return true;
+}
+
+bool SEEL_Data_Queue::add(SEEL_Msg_Handle handle, SEEL_Msg_Class msg_class, uint8_t src, bool own)
+{
+    if (handle == SEEL_MSG_NO_HANDLE || _size >= SEEL_SNODE_MSG_QUEUE_SIZE)
+    {
+        return false;
+    }
+
+    uint8_t slot = 0;
+    while (_class[slot] != MSG_CLASS_NONE)
+    {
+        ++slot;
+    }
+    _handles[slot] = handle;
+    _class[slot] = msg_class;
+    _src[slot] = src;
+    _own[slot] = own;
+    _order[_size++] = slot;
+
+    return true;
+}
+
+uint8_t SEEL_Data_Queue::select()
+{
+    uint8_t slot = find(MSG_CLASS_CONTROL, SEEL_DQ_ANY_SRC);
+    if (slot != SEEL_DQ_NO_SLOT)
+    {
+        return slot;
+    }
+
+    // Next child after the last one served gets the turn; oldest msg of that child
+    uint8_t fwd = SEEL_DQ_NO_SLOT;
+    uint8_t best_turn = UINT8_MAX;
+    for (uint8_t i = 0; i < _size; ++i)
+    {
+        uint8_t s = _order[i];
+        uint8_t turn = (uint8_t) (_src[s] - _last_fwd_src - 1);
+        if (_class[s] == MSG_CLASS_FWD && (fwd == SEEL_DQ_NO_SLOT || turn < best_turn))
+        {
+            fwd = s;
+            best_turn = turn;
+        }
+    }
+
+    uint8_t own = find(MSG_CLASS_OWN, SEEL_DQ_ANY_SRC);
+    if (own != SEEL_DQ_NO_SLOT && (fwd == SEEL_DQ_NO_SLOT || _last_class == MSG_CLASS_FWD))
+    {
+        _last_class = MSG_CLASS_OWN;
+        return own;
+    }
+    if (fwd != SEEL_DQ_NO_SLOT)
+    {
+        _last_class = MSG_CLASS_FWD;
+        _last_fwd_src = _src[fwd];
+    }
+    return fwd;
+}
+
+uint8_t SEEL_Data_Queue::find(SEEL_Msg_Class msg_class, uint16_t src, bool newest)
+{
+    uint8_t found = SEEL_DQ_NO_SLOT;
+    for (uint8_t i = 0; i < _size; ++i)
+    {
+        uint8_t s = _order[i];
+        if (s != _head && _class[s] == msg_class && (src == SEEL_DQ_ANY_SRC || _src[s] == src))
+        {
+            found = s;
+            if (!newest)
+            {
+                break;
+            }
+        }
+    }
+    return found;
+}
+
+uint8_t SEEL_Data_Queue::select_victim(SEEL_Msg_Class msg_class, uint8_t src)
+{
+    if (SEEL_QUEUE_FWD_FAIR_ENABLE && msg_class == MSG_CLASS_FWD)
+    {
+        // Count forwarded slots per child; the arriving child counts its arriving msg
+        uint8_t src_count = 1;
+        uint8_t max_src = 0;
+        uint8_t max_count = 0;
+        for (uint8_t i = 0; i < _size; ++i)
+        {
+            uint8_t s = _order[i];
+            if (_class[s] != MSG_CLASS_FWD)
+            {
+                continue;
+            }
+            uint8_t count = 0;
+            for (uint8_t j = 0; j < _size; ++j)
+            {
+                count += (_class[_order[j]] == MSG_CLASS_FWD && _src[_order[j]] == _src[s]);
+            }
+            if (_src[s] == src)
+            {
+                src_count = count + 1;
+            }
+            if (count > max_count && find(MSG_CLASS_FWD, _src[s]) != SEEL_DQ_NO_SLOT)
+            {
+                max_src = _src[s];
+                max_count = count;
+            }
+        }
+        if (max_count > src_count)
+        {
+            return find(MSG_CLASS_FWD, max_src, true);
+        }
+    }
+
+    switch (SEEL_QDROP_POLICY)
+    {
+        case SEEL_QDROP_OLDEST_OWN:
+            return find(MSG_CLASS_OWN, SEEL_DQ_ANY_SRC);
+        case SEEL_QDROP_STALEST:
+            for (uint8_t i = 0; i < _size; ++i)
+            {
+                uint8_t s = _order[i];
+                if (s != _head && _class[s] != MSG_CLASS_CONTROL)
+                {
+                    return s;
+                }
+            }
+            return SEEL_DQ_NO_SLOT;
+        default:
+            return SEEL_DQ_NO_SLOT;
+    }
+}
+
+void SEEL_Data_Queue::remove(uint8_t slot)
+{
+    uint8_t i = 0;
+    while (_order[i] != slot)
+    {
+        ++i;
+    }
+    for (--_size; i < _size; ++i)
+    {
+        _order[i] = _order[i + 1];
+    }
+    _class[slot] = MSG_CLASS_NONE;
+    _msg_pool_ptr->release(_handles[slot]);
+    if (slot == _head)
+    {
+        _head = SEEL_DQ_NO_SLOT;
+    }
+}
+
+void SEEL_Data_Queue::print()
+{
+    if (!SEEL_Print::enabled(SEEL_LOG_QUEUE, SEEL_LOG_LEVEL_DEBUG))
+    {
+        return;
+    }
+
+    SEEL_Print::print(F("SIZE: "));
+    SEEL_Print::print(_size);
+    SEEL_Print::print(F(" [ "));
+
+    // Each msg is printed as "cmd:src"
+    for (uint8_t i = 0; i < _size; ++i)
+    {
+        SEEL_Print::print(_msg_pool_ptr->get(_handles[_order[i]])->cmd);
+        SEEL_Print::print(F(":"));
+        SEEL_Print::print(_src[_order[i]]);
+        SEEL_Print::print(F(" "));
+    }
+
+    SEEL_Print::println(F("]"));
+    SEEL_Print::flush();
+}
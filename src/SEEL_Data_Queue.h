@@ -0,0 +1,106 @@
+/*
+The SEEL repository can be found at: https://github.com/SEEL-Group/SEEL
+Copyright (C) SEEL Group 2021 all rights reserved
+See license file in root folder for more licensing details
+See SEEL_documentation.pdf for protocol description details
+
+File purpose:   SNODE send queue that separates control, own and forwarded msgs
+*/
+
+#ifndef SEEL_Data_Queue_h
+#define SEEL_Data_Queue_h
+
+#include "SEEL_Defines.h"
+#include "SEEL_Msg_Pool.h"
+
+// Traffic classes held by SEEL_Data_Queue
+enum SEEL_Msg_Class
+{
+    MSG_CLASS_CONTROL, // ID_CHECK msgs, own or forwarded
+    MSG_CLASS_OWN, // DATA msgs created by this NODE
+    MSG_CLASS_FWD, // DATA msgs forwarded for a child
+    MSG_CLASS_NONE
+};
+
+// All classes share SEEL_SNODE_MSG_QUEUE_SIZE slots, each slot holds a handle to a msg in "msg_pool"
+// Send order: control msgs first (oldest first), then own and forwarded msgs alternate.
+// Forwarded msgs are picked round-robin by the child they were received from, oldest first per child
+// On overflow, see SEEL_QDROP_POLICY and SEEL_QUEUE_FWD_FAIR_ENABLE in SEEL_Params.h
+class SEEL_Data_Queue
+{
+public:
+    // ***************************************************
+    // Member functions
+
+    // Constructor
+    SEEL_Data_Queue(SEEL_Msg_Pool* msg_pool);
+
+    // Getters & Setters
+    bool empty() { return _size == 0; }
+    uint8_t size() { return _size; }
+    uint8_t max_size() { return SEEL_SNODE_MSG_QUEUE_SIZE; }
+
+    // Removes all msgs, releasing them to the pool
+    void clear();
+
+    // Returns the handle of the next msg to send, SEEL_MSG_NO_HANDLE if empty
+    // The same msg is returned until pop_front() is called, even if other msgs are added in between
+    SEEL_Msg_Handle front_handle();
+
+    // Returns the msg of front_handle(), NULL if empty
+    SEEL_Message* front();
+
+    // Returns true if the msg of front_handle() was added as created by this NODE, see add()
+    bool front_own();
+
+    // Removes the msg returned by front() and releases it to the pool
+    void pop_front();
+
+    // Frees a slot for an arriving msg of class "msg_class" from "src" if the queue is full
+    // Returns false if the arriving msg should be dropped. If another msg was evicted, its class is written
+    // to "evicted", otherwise MSG_CLASS_NONE is written
+    bool make_room(SEEL_Msg_Class msg_class, uint8_t src, SEEL_Msg_Class* evicted);
+
+    // Adds the msg of "handle" with class "msg_class", "src" is the NODE the msg was received from (this NODE for own msgs)
+    // "own" marks msgs created by this NODE, kept even if the NODE's ID changes while the msg is queued
+    // On success the queue takes over the caller's reference to "handle"
+    // Returns false if the queue is full or "handle" is SEEL_MSG_NO_HANDLE; the caller keeps its reference
+    bool add(SEEL_Msg_Handle handle, SEEL_Msg_Class msg_class, uint8_t src, bool own);
+
+    void print();
+
+private:
+    // ***************************************************
+    // Member functions
+
+    // Picks the slot to send next, returns SEEL_DQ_NO_SLOT if empty
+    uint8_t select();
+
+    // Returns the oldest slot of "msg_class" (and "src" if not SEEL_DQ_ANY_SRC) that is not being sent,
+    // or SEEL_DQ_NO_SLOT if there is none. If "newest" is true, returns the newest slot instead
+    uint8_t find(SEEL_Msg_Class msg_class, uint16_t src, bool newest = false);
+
+    // Picks the slot to evict for an arriving msg, returns SEEL_DQ_NO_SLOT to drop the arriving msg
+    uint8_t select_victim(SEEL_Msg_Class msg_class, uint8_t src);
+
+    // Frees "slot", releases its msg and removes it from the arrival order
+    void remove(uint8_t slot);
+
+    // ***************************************************
+    // Member variables
+    static const uint16_t SEEL_DQ_ANY_SRC = 0x100; // Matches any "src" in find()
+    static const uint8_t SEEL_DQ_NO_SLOT = SEEL_SNODE_MSG_QUEUE_SIZE; // Invalid slot index
+
+    SEEL_Msg_Pool* _msg_pool_ptr;
+    SEEL_Msg_Handle _handles[SEEL_SNODE_MSG_QUEUE_SIZE];
+    uint8_t _class[SEEL_SNODE_MSG_QUEUE_SIZE]; // SEEL_Msg_Class per slot, MSG_CLASS_NONE if free
+    uint8_t _src[SEEL_SNODE_MSG_QUEUE_SIZE];
+    bool _own[SEEL_SNODE_MSG_QUEUE_SIZE];
+    uint8_t _order[SEEL_SNODE_MSG_QUEUE_SIZE]; // Used slots, oldest first
+    uint8_t _size;
+    uint8_t _head; // Slot returned by front(), SEEL_DQ_NO_SLOT if not picked yet
+    uint8_t _last_class; // Class sent last, own and forwarded msgs alternate
+    uint8_t _last_fwd_src; // Child whose forwarded msg was sent last
+};
+
+#endif // SEEL_Data_Queue_h
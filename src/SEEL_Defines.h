@@ -10,82 +10,47 @@ File purpose:   Set up constants and structs used in the SEEL protocol
 #ifndef SEEL_Defines_h
 #define SEEL_Defines_h
 
+#include <stddef.h> // offsetof
+
 #include "SEEL_Params.h"
+#include "SEEL_Wire.h" // Msg commands and layout, shared with host tools
 #include "SEEL_Queue.h"
 #include "SEEL_Queue.cpp" // cpp file required for templates
+#include "SEEL_Ring.h"
+#include "SEEL_Ring.cpp" // cpp file required for templates
 #include "SEEL_Print.h"
 #include "SEEL_Assert.h"
+#include "SEEL_Fixed.h"
 
 /* 
 This file contains useful constants and structures used by the SEEL protocol
 Values in this header file should NOT be modified; instead modify values in SEEL_Params.h
 */
 
-/* MESSAGE COMMANDS */
-const uint8_t SEEL_CMD_BCAST      = 0;
-const uint8_t SEEL_CMD_ACK        = 1;
-const uint8_t SEEL_CMD_DATA       = 2;
-const uint8_t SEEL_CMD_ID_CHECK   = 3;
-
-/* MESSAGE DESCRIPTION, SIZE in Bytes */
-const uint8_t SEEL_MSG_TARG_INDEX   = 0;
-const uint8_t SEEL_MSG_TARG_SIZE    = 1;
-const uint8_t SEEL_MSG_SEND_INDEX   = 1;
-const uint8_t SEEL_MSG_SEND_SIZE    = 1;
-const uint8_t SEEL_MSG_CMD_INDEX    = 2;
-const uint8_t SEEL_MSG_CMD_SIZE     = 1;
-const uint8_t SEEL_MSG_SEQ_INDEX    = 3;
-const uint8_t SEEL_MSG_SEQ_SIZE     = 1;
-const uint8_t SEEL_MSG_OSEND_INDEX  = 4;
-const uint8_t SEEL_MSG_OSEND_SIZE   = 1;
-const uint8_t SEEL_MSG_MISC_INDEX   = 5;
-const uint8_t SEEL_MSG_MISC_SIZE    = 18;
-const uint8_t SEEL_MSG_USER_INDEX   = 23; // USER_SIZE defined in SEEL_Params.h
-const uint8_t SEEL_MSG_DATA_SIZE = SEEL_MSG_MISC_SIZE + SEEL_MSG_USER_SIZE;
-const uint8_t SEEL_MSG_TOTAL_SIZE = SEEL_MSG_TARG_SIZE + SEEL_MSG_SEND_SIZE + SEEL_MSG_CMD_SIZE
-    + SEEL_MSG_SEQ_SIZE + SEEL_MSG_OSEND_SIZE + SEEL_MSG_MISC_SIZE + SEEL_MSG_USER_SIZE;
-
-/* MESSAGE DATA DESCRIPTION, SIZE in Bytes */
-
-// For CMD: DATA
-// Filled by user
-
-// For CMD: ACK
-// Filled with acknowledgement targets
-
-// For CMD: ID_CHECK
-const uint8_t SEEL_MSG_DATA_ID_CHECK_INDEX = 0;
-const uint8_t SEEL_MSG_DATA_ID_CHECK_SIZE = 1;
-const uint8_t SEEL_MSG_DATA_ID_ENCRYPT_INDEX = 1;
-const uint8_t SEEL_MSG_DATA_ID_ENCRYPT_SIZE = 4;
-
-// For CMD: BCAST
-const uint8_t SEEL_MSG_DATA_FIRST_BCAST_INDEX = 0;
-const uint8_t SEEL_MSG_DATA_FIRST_BCAST_SIZE = 1;
-const uint8_t SEEL_MSG_DATA_BCAST_COUNT_INDEX = 1;
-const uint8_t SEEL_MSG_DATA_BCAST_COUNT_SIZE = 1;
-const uint8_t SEEL_MSG_DATA_TIME_SYNC_INDEX = 2;
-const uint8_t SEEL_MSG_DATA_TIME_SYNC_SIZE = 4;
-const uint8_t SEEL_MSG_DATA_AWAKE_TIME_SECONDS_INDEX = 6;
-const uint8_t SEEL_MSG_DATA_AWAKE_TIME_SECONDS_SIZE = 4;
-const uint8_t SEEL_MSG_DATA_SLEEP_TIME_SECONDS_INDEX = 10;
-const uint8_t SEEL_MSG_DATA_SLEEP_TIME_SECONDS_SIZE = 4;
-const uint8_t SEEL_MSG_DATA_HOP_COUNT_INDEX = 14;
-const uint8_t SEEL_MSG_DATA_HOP_COUNT_SIZE = 1;
-const uint8_t SEEL_MSG_DATA_RSSI_INDEX = 15;
-const uint8_t SEEL_MSG_DATA_RSSI_SIZE = 1;
-const uint8_t SEEL_MSG_DATA_ID_FEEDBACK_INDEX = 16; // Variable size, default is two. Expand with user size
-const uint8_t SEEL_MSG_DATA_ID_FEEDBACK_DEFAULT_SIZE = 2; // Actual size is 2*floor((SEEL_MSG_DATA_ID_FEEDBACK_DEFAULT_SIZE + SEEL_MSG_USER_SIZE) / 2.0)
-const uint8_t SEEL_MSG_DATA_USER_INDEX = 18;  // USER_SIZE defined in SEEL_Params.h
-const uint8_t SEEL_MSG_DATA_ID_FEEDBACK_TOTAL_SIZE = SEEL_MSG_DATA_ID_FEEDBACK_DEFAULT_SIZE + SEEL_MSG_USER_SIZE;
-
 /* MSG Info and Signals */
 const uint8_t SEEL_GNODE_ID = 0;
 const uint8_t SEEL_ID_CHECK_ERROR = 0;
 const uint8_t SEEL_BCAST_FB = 1; // Signals the system has restarted and that the bcast msg is the first one (for init purposes). Otherwise 0.
 
+/* SCHEDULER EVENTS, bit position in the scheduler event mask */
+const uint8_t SEEL_SCHED_EVENT_RX = 0; // Packet captured by the receive ISR
+const uint8_t SEEL_SCHED_EVENT_TX_DONE = 1; // Transmission finished
+const uint8_t SEEL_SCHED_EVENT_BCAST_SENT = 2; // This NODE forwarded the cycle's bcast msg
+const uint8_t SEEL_SCHED_EVENT_CAD_DONE = 3; // Channel activity detection finished
+const uint8_t SEEL_SCHED_EVENT_COUNT = 8; // Width of the event mask
+
 /* MISC */
 const uint32_t SEEL_SECS_TO_MILLIS = 1000;
+const uint32_t SEEL_SEND_PARK_MILLIS = UINT32_MAX / 2; // Re-arm delay of the idle send task, woken early by SEEL_Node::send_ready()
+
+/* FIXED POINT PARAMS, Q16.16 forms of float params in SEEL_Params.h */
+static_assert(SEEL_EB_EXP_SCALE >= 0.0f && SEEL_EB_EXP_SCALE < 65536.0f, "SEEL_EB_EXP_SCALE out of Q16.16 range");
+static_assert(SEEL_FORCE_SLEEP_AWAKE_MULT >= 0.0f && SEEL_FORCE_SLEEP_AWAKE_MULT < 65536.0f, "SEEL_FORCE_SLEEP_AWAKE_MULT out of Q16.16 range");
+static_assert(SEEL_FORCE_SLEEP_AWAKE_DURATION_SCALE >= 0.0f && SEEL_FORCE_SLEEP_AWAKE_DURATION_SCALE < 65536.0f,
+    "SEEL_FORCE_SLEEP_AWAKE_DURATION_SCALE out of Q16.16 range");
+const SEEL_Q16 SEEL_EB_EXP_SCALE_Q16 = seel_q16_from_float(SEEL_EB_EXP_SCALE);
+const SEEL_Q16 SEEL_FORCE_SLEEP_AWAKE_MULT_Q16 = seel_q16_from_float(SEEL_FORCE_SLEEP_AWAKE_MULT);
+const SEEL_Q16 SEEL_FORCE_SLEEP_AWAKE_DURATION_SCALE_Q16 = seel_q16_from_float(SEEL_FORCE_SLEEP_AWAKE_DURATION_SCALE);
 
 // SEEL message packed into a more readable form
 struct SEEL_Message
@@ -129,4 +94,31 @@ struct SEEL_Message
 
 };
 
+// SEEL_Message is sent and received as raw bytes, so its layout must match the message description above
+static_assert(sizeof(SEEL_Message) == SEEL_MSG_TOTAL_SIZE, "SEEL_Message size does not match wire format");
+static_assert(offsetof(SEEL_Message, cmd) == SEEL_MSG_CMD_INDEX, "SEEL_Message layout does not match wire format");
+static_assert(offsetof(SEEL_Message, orig_send_id) == SEEL_MSG_OSEND_INDEX, "SEEL_Message layout does not match wire format");
+static_assert(offsetof(SEEL_Message, data) == SEEL_MSG_MISC_INDEX, "SEEL_Message layout does not match wire format");
+
+/* AIRTIME CHECKS */
+static_assert(SEEL_MSG_AIRTIME_SIZE == SEEL_MSG_TOTAL_SIZE, "SEEL_MSG_AIRTIME_SIZE does not match SEEL_MSG_TOTAL_SIZE");
+static_assert(SEEL_RFM95_SF >= 6 && SEEL_RFM95_SF <= 12, "SEEL_RFM95_SF must be 6 to 12");
+static_assert(SEEL_RFM95_SF != 6 || SEEL_RFM95_IMPLICIT_HEADER, "SF 6 requires implicit header mode");
+static_assert(SEEL_RFM95_GNODE_CR >= 5 && SEEL_RFM95_GNODE_CR <= 8 && SEEL_RFM95_SNODE_CR >= 5 && SEEL_RFM95_SNODE_CR <= 8,
+    "SEEL_RFM95_*_CR must be 5 to 8");
+
+/* RX GATE CHECKS */
+static_assert(!SEEL_RX_GATE_ENABLE || SEEL_TDMA_USE_TDMA, "SEEL_RX_GATE_ENABLE requires TDMA");
+static_assert(!SEEL_RX_GATE_ENABLE || SEEL_TDMA_SLOTS <= 32, "SEEL_RX_GATE_ENABLE supports at most 32 TDMA slots");
+static_assert(2 * SEEL_RX_GATE_GUARD_MILLIS < SEEL_TDMA_SLOT_WAIT_MILLIS, "SEEL_RX_GATE_GUARD_MILLIS must be less than half a TDMA slot");
+
+/* CAD CHECKS */
+static_assert(SEEL_CAD_BCAST_PREAMBLE_LEN <= UINT16_MAX, "SEEL_CAD_PERIOD_MILLIS too long for the bcast preamble");
+static_assert(SEEL_CAD_FALSE_DETECT_LIMIT > 0, "SEEL_CAD_FALSE_DETECT_LIMIT must be at least 1");
+
+/* EARLY SLEEP CHECKS */
+static_assert(SEEL_EARLY_SLEEP_SILENT_CYCLES >= 2, "SEEL_EARLY_SLEEP_SILENT_CYCLES must be at least 2");
+static_assert(SEEL_EARLY_SLEEP_MAX_CHILDREN > 0, "SEEL_EARLY_SLEEP_MAX_CHILDREN must be at least 1");
+static_assert((SEEL_CMD_ID_CHECK & SEEL_CMD_FLAG_SUBTREE_DONE) == 0, "SEEL_CMD_* overlaps a cmd flag bit");
+
 #endif // SEEL_Defines
\ No newline at end of file
@@ -0,0 +1,34 @@
+/*
+The SEEL repository can be found at: https://github.com/SEEL-Group/SEEL
+Copyright (C) SEEL Group 2021 all rights reserved
+See license file in root folder for more licensing details
+See SEEL_documentation.pdf for protocol description details
+
+File purpose:   See SEEL_Fixed.h
+*/
+
+#include "SEEL_Fixed.h"
+
+SEEL_Q16 SEEL_Fixed::mul(SEEL_Q16 a, SEEL_Q16 b)
+{
+    uint64_t product = ((uint64_t) a * b) >> SEEL_Q16_SHIFT;
+    return (product > SEEL_Q16_MAX) ? SEEL_Q16_MAX : (SEEL_Q16) product;
+}
+
+SEEL_Q16 SEEL_Fixed::pow(SEEL_Q16 base, uint32_t exp)
+{
+    SEEL_Q16 result = SEEL_Q16_ONE;
+    while (exp > 0)
+    {
+        if (exp & 1)
+        {
+            result = mul(result, base);
+        }
+        exp >>= 1;
+        if (exp > 0)
+        {
+            base = mul(base, base);
+        }
+    }
+    return result;
+}
@@ -0,0 +1,44 @@
+/*
+The SEEL repository can be found at: https://github.com/SEEL-Group/SEEL
+Copyright (C) SEEL Group 2021 all rights reserved
+See license file in root folder for more licensing details
+See SEEL_documentation.pdf for protocol description details
+
+File purpose:   Unsigned Q16.16 fixed point math for timing computations, avoids soft-float pow() on AVR
+*/
+
+#ifndef SEEL_Fixed_h
+#define SEEL_Fixed_h
+
+#include <stdint.h>
+
+// Unsigned Q16.16: upper 16 bits hold the integer part, lower 16 bits the fraction
+typedef uint32_t SEEL_Q16;
+
+const uint8_t SEEL_Q16_SHIFT = 16;
+const SEEL_Q16 SEEL_Q16_ONE = (SEEL_Q16) 1 << SEEL_Q16_SHIFT;
+const SEEL_Q16 SEEL_Q16_MAX = UINT32_MAX; // Saturation value
+
+// Converts float params at compile time; "value" must be in [0, 65536)
+constexpr SEEL_Q16 seel_q16_from_float(float value)
+{
+    return (SEEL_Q16) (value * SEEL_Q16_ONE + 0.5f);
+}
+
+class SEEL_Fixed
+{
+public:
+    // Returns "a" * "b", saturates at SEEL_Q16_MAX
+    static SEEL_Q16 mul(SEEL_Q16 a, SEEL_Q16 b);
+
+    // Returns "base" ^ "exp" by squaring, saturates at SEEL_Q16_MAX
+    static SEEL_Q16 pow(SEEL_Q16 base, uint32_t exp);
+
+    // Returns integer "value" * "factor", truncated; cannot overflow
+    static uint64_t scale(uint32_t value, SEEL_Q16 factor)
+    {
+        return ((uint64_t) value * factor) >> SEEL_Q16_SHIFT;
+    }
+};
+
+#endif // SEEL_Fixed_h
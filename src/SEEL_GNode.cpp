@@ -15,11 +15,14 @@ void SEEL_GNode::init(  SEEL_Scheduler* ref_scheduler,
             uint32_t cycle_period_secs, uint32_t snode_awake_time_secs, 
             uint32_t tdma_slot)
 {
-    SEEL_Node::init(SEEL_GNODE_ID, tdma_slot);
+    SEEL_Node::init(SEEL_GNODE_ID, tdma_slot, &_gnode_msg_pool);
     rfm_param_init(cs_pin, reset_pin, int_pin, SEEL_RFM95_GNODE_TX, SEEL_RFM95_GNODE_CR);
 
-    SEEL_Print::print(F("SEEL Cycle Time: ")); SEEL_Print::println(cycle_period_secs);
-    SEEL_Print::print(F("SEEL Awake Time: ")); SEEL_Print::println(snode_awake_time_secs);
+    if (SEEL_Print::enabled(SEEL_LOG_SLEEP, SEEL_LOG_LEVEL_INFO))
+    {
+        SEEL_Print::print(F("SEEL Cycle Time: ")); SEEL_Print::println(cycle_period_secs);
+        SEEL_Print::print(F("SEEL Awake Time: ")); SEEL_Print::println(snode_awake_time_secs);
+    }
 
     // Initialize member variables
     _ref_scheduler = ref_scheduler;
@@ -40,27 +43,36 @@ void SEEL_GNode::init(  SEEL_Scheduler* ref_scheduler,
     _cycle_transmissions.clear();
 
     // Initialize tasks with this inst
-    _task_bcast.set_inst(this);
+    _task_bcast.set_inst(this, SEEL_Task::PRIORITY_CRITICAL);
+    _task_bcast_send.set_inst(this, SEEL_Task::PRIORITY_CRITICAL);
     _task_receive.set_inst(this);
 
-    bool added = _ref_scheduler->add_task(&_task_bcast);
+    // Bcast runs once per cycle; periodic scheduling keeps the cycle from drifting by the bcast task's run time
+    bool added = _ref_scheduler->add_periodic_task(&_task_bcast, _cycle_period_secs * SEEL_SECS_TO_MILLIS);
     SEEL_Assert::assert(added, SEEL_ASSERT_FILE_NUM_GNODE, __LINE__);
     added = _ref_scheduler->add_task(&_task_receive);
     SEEL_Assert::assert(added, SEEL_ASSERT_FILE_NUM_GNODE, __LINE__);
-    added = _ref_scheduler->add_task(&_task_send); // inst set in SEEL_Node.cpp
+    send_start(); // inst set in SEEL_Node.cpp
+    added = _ref_scheduler->add_event_task(&_task_tx_done, SEEL_SCHED_EVENT_TX_DONE); // inst set in SEEL_Node.cpp
     SEEL_Assert::assert(added, SEEL_ASSERT_FILE_NUM_GNODE, __LINE__);
+
+    rfm_receive_start();
 }
 
 void SEEL_GNode::print_bcast_queue()
 {
+    if (!SEEL_Print::enabled(SEEL_LOG_QUEUE, SEEL_LOG_LEVEL_DEBUG))
+    {
+        return;
+    }
+
     SEEL_Print::print(F("Bcast queue: ["));
-    for (uint32_t i = 0; i < _pending_bcast_ids.size(); ++i)
+    for (SEEL_Default_Queue<SEEL_ID_BCAST>::iterator it = _pending_bcast_ids.begin(); it != _pending_bcast_ids.end(); ++it)
     {
-        SEEL_Print::print(_pending_bcast_ids.front()->id);
+        SEEL_Print::print(it->id);
         SEEL_Print::print(F("->"));
-        SEEL_Print::print(_pending_bcast_ids.front()->response);
+        SEEL_Print::print(it->response);
         SEEL_Print::print(F(" "));
-        _pending_bcast_ids.recycle_front();
     }
     SEEL_Print::println(F("]"));
 }
@@ -124,7 +136,7 @@ void SEEL_GNode::id_check(uint32_t msg_id, uint32_t unique_key)
         // Re-assign ID to available, counting from the back since users are more likely
         // to assign low ID values (prevents confusion)
         found = false;
-        uint32_t id_assign_start = min(pow(2, SEEL_MSG_TARG_SIZE * 8), SEEL_MAX_NODES) - 1;
+        uint32_t id_assign_start = min((uint32_t) 1 << (SEEL_MSG_TARG_SIZE * 8), SEEL_MAX_NODES) - 1;
         for (uint32_t i = id_assign_start; i > SEEL_GNODE_ID && !found; --i)
         {
             if (id_avail(i))
@@ -155,78 +167,101 @@ void SEEL_GNode::id_check(uint32_t msg_id, uint32_t unique_key)
 
 void SEEL_GNode::SEEL_Task_GNode_Receive::run()
 {
-    SEEL_Message msg;
-    int8_t msg_rssi;
-    uint32_t receive_offset;
-
-    // Check if there is a message available
-    if (!_inst->rfm_receive_msg(&msg, msg_rssi, receive_offset))
+    // Process every packet captured by the receive ISR since the last run
+    while (_inst->rfm_msg_avail())
     {
-        bool added = _inst->_ref_scheduler->add_task(&_inst->_task_receive);
-        SEEL_Assert::assert(added, SEEL_ASSERT_FILE_NUM_GNODE, __LINE__);
-        return;
-    }
+        int8_t msg_rssi;
+        uint32_t receive_offset;
 
-    // Since GNode receive function can take a while, don't receive until ACK queue is emptied
-    // to prevent missing TDMA sent slots
-    if (!_inst->_ack_queue.empty())
-    {
-        bool added = _inst->_ref_scheduler->add_task(&_inst->_task_receive);
-        SEEL_Assert::assert(added, SEEL_ASSERT_FILE_NUM_GNODE, __LINE__);
-        return;
+        // Msg is handled in place in the receive ring, then released back to the receive ISR
+        SEEL_Message* msg = _inst->rfm_receive_msg(msg_rssi, receive_offset);
+        if (msg != NULL)
+        {
+            _inst->handle_msg(msg, msg_rssi);
+        }
+        _inst->rfm_receive_release();
     }
 
-    if (msg.targ_id != SEEL_GNODE_ID)
+    // Run again once the receive ISR captures another packet
+    bool added = _inst->_ref_scheduler->add_event_task(&_inst->_task_receive, SEEL_SCHED_EVENT_RX);
+    SEEL_Assert::assert(added, SEEL_ASSERT_FILE_NUM_GNODE, __LINE__);
+}
+
+bool SEEL_GNode::rfm_header_accept(const SEEL_Message* header)
+{
+    // GNODE only handles data and ID check msgs targeted to it
+    return header->targ_id == SEEL_GNODE_ID && (header->cmd == SEEL_CMD_DATA || header->cmd == SEEL_CMD_ID_CHECK);
+}
+
+void SEEL_GNode::handle_msg(SEEL_Message* msg, int8_t msg_rssi)
+{
+    if (msg->targ_id != SEEL_GNODE_ID)
     {
         // Message not intended for GNode
-        bool added = _inst->_ref_scheduler->add_task(&_inst->_task_receive);
-        SEEL_Assert::assert(added, SEEL_ASSERT_FILE_NUM_GNODE, __LINE__);
         return;
     }
 
     // Check message type:
     // 1. Data msg - Give to user receive function to handle
     // 2. ID check - Check ID database for ID acceptability
-    if (msg.cmd == SEEL_CMD_DATA)
+    if (msg->cmd == SEEL_CMD_DATA)
     {
         // Re-affirm node is still in network by updating its saved_bcast_count
         // Set container status to active in case gateway had to restart. so we don't lose comms with already-initialized
         // nodes. However, possible security risk of intruder nodes
-        _inst->_id_container[msg.orig_send_id].used = true;
-        _inst->_id_container[msg.orig_send_id].saved_bcast_count = (_inst->_bcast_count & 0x7F);
+        _id_container[msg->orig_send_id].used = true;
+        _id_container[msg->orig_send_id].saved_bcast_count = (_bcast_count & 0x7F);
         // Provide msg to user callback
-        if (_inst->_user_cb_data != NULL)
+        if (_user_cb_data != NULL)
         {
-            _inst->_user_cb_data(msg.data, msg_rssi);
+            _user_cb_data(msg->data, msg_rssi);
         }
-        _inst->enqueue_ack(&msg);
+        enqueue_ack(msg);
     }
-    else if (msg.cmd == SEEL_CMD_ID_CHECK)
+    else if (msg->cmd == SEEL_CMD_ID_CHECK)
     {
         // Protocol: When verifying node id's, the node id is placed
         // in the first element of the data slot so the Gnode should check this slot for ID addition
-        uint32_t unique_key = 0;
-        unique_key += (uint32_t)msg.data[SEEL_MSG_DATA_ID_ENCRYPT_INDEX] << 24;
-        unique_key += (uint32_t)msg.data[SEEL_MSG_DATA_ID_ENCRYPT_INDEX + 1] << 16;
-        unique_key += (uint32_t)msg.data[SEEL_MSG_DATA_ID_ENCRYPT_INDEX + 2] << 8;
-        unique_key += (uint32_t)msg.data[SEEL_MSG_DATA_ID_ENCRYPT_INDEX + 3];
-
-        _inst->id_check(msg.data[SEEL_MSG_DATA_ID_CHECK_INDEX], unique_key);
-        _inst->enqueue_ack(&msg);
+        uint32_t unique_key = SEEL_Wire_ID_Check::Unique_Key::get(msg->data);
+
+        id_check(SEEL_Wire_ID_Check::ID::get(msg->data), unique_key);
+        enqueue_ack(msg);
     }
+}
 
-    bool added = _inst->_ref_scheduler->add_task(&_inst->_task_receive);
+void SEEL_GNode::SEEL_Task_GNode_Bcast::run()
+{
+    // Stays periodic so cycles keep aligned to this task's scheduled time, however long the send waits
+    bool added = _inst->_ref_scheduler->add_task(&_inst->_task_bcast_send);
     SEEL_Assert::assert(added, SEEL_ASSERT_FILE_NUM_GNODE, __LINE__);
 }
 
-void SEEL_GNode::SEEL_Task_GNode_Bcast::run()
+void SEEL_GNode::SEEL_Task_GNode_Bcast_Send::run()
 {
     // Don't use SEEL_Node's send system to bypass collision avoidance; BCAST on GNODE must be sent without delay
-    SEEL_Message to_send;
+    // Only wait for a transmission already in progress (at most one ToA, bounded by SEEL_TRANSMISSION_TIMEOUT_MILLIS)
+    // Polled rather than spun on, so other tasks (e.g. draining the receive ring) keep running meanwhile
+    if (_inst->rfm_tx_busy())
+    {
+        _inst->_ref_scheduler->rearm_current_task(1);
+        return;
+    }
+
+    // The previous transmission has completed, so a pool msg is free
+    SEEL_Msg_Handle handle = _inst->_msg_pool_ptr->alloc();
+    SEEL_Assert::assert(handle != SEEL_MSG_NO_HANDLE, SEEL_ASSERT_FILE_NUM_GNODE, __LINE__);
+    SEEL_Message& to_send = *_inst->_msg_pool_ptr->get(handle);
 
     // Print out any pending ID's
     _inst->print_bcast_queue();
 
+#if SEEL_SCHED_STATS_ENABLE
+    // Scheduler statistics of the cycle that just ended
+    _inst->_cb_info.prev_sched_summary = _inst->_ref_scheduler->get_stats_summary();
+    _inst->_ref_scheduler->print_stats();
+    _inst->_ref_scheduler->reset_stats();
+#endif // SEEL_SCHED_STATS_ENABLE
+
     // Clear ack queue
     _inst->_ack_queue.clear();
 
@@ -235,7 +270,9 @@ void SEEL_GNode::SEEL_Task_GNode_Bcast::run()
     _inst->_cycle_transmissions.clear();
 
     // Check if there are any new ID's that need to be added to gateway signal
-    for (uint32_t i = 0; i < SEEL_MSG_DATA_ID_FEEDBACK_TOTAL_SIZE; i += 2)
+    // ID feedback continues from its default bytes into the user bytes, odd trailing bytes are left unused
+    uint8_t* feedback = SEEL_Wire_Bcast::ID_Feedback::ptr(to_send.data);
+    for (uint32_t i = 0; (i + 1) < SEEL_Wire_Bcast::ID_Feedback::size; i += 2)
     {
         uint8_t id;
         uint8_t response;
@@ -251,48 +288,29 @@ void SEEL_GNode::SEEL_Task_GNode_Bcast::run()
             response = _inst->_pending_bcast_ids.front()->response;
             _inst->_pending_bcast_ids.pop_front();
         }
-        
-        if (i < SEEL_MSG_DATA_ID_FEEDBACK_DEFAULT_SIZE)
-        {
-            to_send.data[SEEL_MSG_DATA_ID_FEEDBACK_INDEX + i] = id;
-            to_send.data[SEEL_MSG_DATA_ID_FEEDBACK_INDEX + i + 1] = response;
-        }
-        else // User space
-        {
-            to_send.data[SEEL_MSG_DATA_USER_INDEX + (i - SEEL_MSG_DATA_ID_FEEDBACK_DEFAULT_SIZE)] = id;
-            to_send.data[SEEL_MSG_DATA_USER_INDEX + (i - SEEL_MSG_DATA_ID_FEEDBACK_DEFAULT_SIZE) + 1] = response;
-        }
+
+        feedback[i] = id;
+        feedback[i + 1] = response;
     }
 
     // Note whether this bcast is the first bcast for the network, used for initialization
-    to_send.data[SEEL_MSG_DATA_FIRST_BCAST_INDEX] = _inst->_first_bcast ? SEEL_BCAST_FB : 0;
+    SEEL_Wire_Bcast::First_Bcast::set(to_send.data, _inst->_first_bcast ? SEEL_BCAST_FB : 0);
 
     // Keep a counter on bcast messages, intended to overflow
-    to_send.data[SEEL_MSG_DATA_BCAST_COUNT_INDEX] = _inst->_bcast_count;
+    SEEL_Wire_Bcast::Bcast_Count::set(to_send.data, _inst->_bcast_count);
 
     // Update cycle information, information stored big endian
-    to_send.data[SEEL_MSG_DATA_AWAKE_TIME_SECONDS_INDEX] = (uint8_t) (_inst->_snode_awake_time_secs >> 24);
-    to_send.data[SEEL_MSG_DATA_AWAKE_TIME_SECONDS_INDEX + 1] = (uint8_t) (_inst->_snode_awake_time_secs >> 16);
-    to_send.data[SEEL_MSG_DATA_AWAKE_TIME_SECONDS_INDEX + 2] = (uint8_t) (_inst->_snode_awake_time_secs >> 8);
-    to_send.data[SEEL_MSG_DATA_AWAKE_TIME_SECONDS_INDEX + 3] = (uint8_t) (_inst->_snode_awake_time_secs);
-
-    to_send.data[SEEL_MSG_DATA_SLEEP_TIME_SECONDS_INDEX] = (uint8_t) (_inst->_snode_sleep_time_secs >> 24);
-    to_send.data[SEEL_MSG_DATA_SLEEP_TIME_SECONDS_INDEX + 1] = (uint8_t) (_inst->_snode_sleep_time_secs >> 16);
-    to_send.data[SEEL_MSG_DATA_SLEEP_TIME_SECONDS_INDEX + 2] = (uint8_t) (_inst->_snode_sleep_time_secs >> 8);
-    to_send.data[SEEL_MSG_DATA_SLEEP_TIME_SECONDS_INDEX + 3] = (uint8_t) (_inst->_snode_sleep_time_secs);
+    SEEL_Wire_Bcast::Awake_Secs::set(to_send.data, _inst->_snode_awake_time_secs);
+    SEEL_Wire_Bcast::Sleep_Secs::set(to_send.data, _inst->_snode_sleep_time_secs);
 
     // Parent selection info
-    to_send.data[SEEL_MSG_DATA_HOP_COUNT_INDEX] = (uint8_t) (_inst->_cb_info.hop_count);
-    to_send.data[SEEL_MSG_DATA_RSSI_INDEX] = (uint8_t) (0); // Filled out later by SNODEs
-
-    // Downside to sys time of 0 is that system time keeps resetting so system cannot schedule tasks longer than cycle duration
-    //_inst->_ref_scheduler->zero_millis_timer(); // Use a system time of 0 for better determinism and less TDMA collision chances
-    uint32_t system_time = millis();
-    system_time += _inst->_tranmission_ToA; // account for transmission delay beforehand
-    to_send.data[SEEL_MSG_DATA_TIME_SYNC_INDEX] = (uint8_t) (system_time >> 24);
-    to_send.data[SEEL_MSG_DATA_TIME_SYNC_INDEX + 1] = (uint8_t) (system_time >> 16);
-    to_send.data[SEEL_MSG_DATA_TIME_SYNC_INDEX + 2] = (uint8_t) (system_time >> 8);
-    to_send.data[SEEL_MSG_DATA_TIME_SYNC_INDEX + 3] = (uint8_t) (system_time);
+    SEEL_Wire_Bcast::Hop_Count::set(to_send.data, _inst->_cb_info.hop_count);
+    SEEL_Wire_Bcast::RSSI::set(to_send.data, 0); // Filled out later by SNODEs
+
+    // Network time is the GNODE's own time; SNODEs sync to it through an offset, so tasks scheduled beyond one cycle are unaffected
+    uint32_t system_time = _inst->_ref_scheduler->get_network_millis();
+    system_time += _inst->_tranmission_ToA + SEEL_BCAST_EXTRA_TOA_MILLIS; // account for transmission delay beforehand
+    SEEL_Wire_Bcast::Time_Sync::set(to_send.data, system_time);
 
     if (_inst->_user_cb_broadcast != NULL)
     {
@@ -302,14 +320,8 @@ void SEEL_GNode::SEEL_Task_GNode_Bcast::run()
     ++_inst->_bcast_count;
     _inst->_first_bcast = false;
 
-    // Re-add bcast task, with cycle delay
-    bool added = _inst->_ref_scheduler->add_task(&_inst->_task_bcast, _inst->_cycle_period_secs * SEEL_SECS_TO_MILLIS);
-    SEEL_Assert::assert(added, SEEL_ASSERT_FILE_NUM_GNODE, __LINE__);
-
     // Send out gateway msg; send out msg at the end of catch immediately transition to receiving msgs
     _inst->create_msg(&to_send, SEEL_GNODE_ID, SEEL_CMD_BCAST);
-    if (_inst->try_send(&to_send, true))
-    {
-        ++(_inst->_cycle_transmissions.bcast);
-    }
+    _inst->try_send(handle, true, TRANS_BCAST);
+    _inst->_msg_pool_ptr->release(handle);
 }
\ No newline at end of file
@@ -80,7 +80,7 @@ private:
     class SEEL_Task_GNode : public SEEL_Task
     {
     public:
-        void set_inst(SEEL_GNode* inst) {_inst = inst; _user_task = false;}
+        void set_inst(SEEL_GNode* inst, SEEL_Task_Priority priority = PRIORITY_SYSTEM) {_inst = inst; _priority = priority;}
     protected:
         SEEL_Task_GNode() {} // Prevents class instantiation
         SEEL_GNode* _inst;
@@ -88,7 +88,8 @@ private:
         friend SEEL_GNode;
     };
 
-    // Checks for LoRa messages. Messages can be either be data messages or ID checks.
+    // Handles LoRa messages captured by the receive ISR, runs when SEEL_SCHED_EVENT_RX is raised.
+    // Messages can be either be data messages or ID checks.
     // Also acknowledges messages
     class SEEL_Task_GNode_Receive : public SEEL_Task_GNode {virtual void run();};
     SEEL_Task_GNode_Receive _task_receive;
@@ -97,6 +98,10 @@ private:
     class SEEL_Task_GNode_Bcast : public SEEL_Task_GNode {virtual void run();};
     SEEL_Task_GNode_Bcast _task_bcast;
 
+    // Sends the bcast started by _task_bcast once a transmission in progress is done
+    class SEEL_Task_GNode_Bcast_Send : public SEEL_Task_GNode {virtual void run();};
+    SEEL_Task_GNode_Bcast_Send _task_bcast_send;
+
     // ***************************************************
     // Member functions
 
@@ -108,8 +113,15 @@ private:
 
     void id_check(uint32_t msg_id, uint32_t unique_key);
 
+    // Receive ISR header filter, see SEEL_Node.h
+    virtual bool rfm_header_accept(const SEEL_Message* header);
+
+    // Handles a single valid msg taken from the receive ring
+    void handle_msg(SEEL_Message* msg, int8_t msg_rssi);
+
     // ***************************************************
     // Member variables
+    SEEL_Msg_Pool_Storage<SEEL_GNODE_MSG_POOL_SIZE> _gnode_msg_pool;
     SEEL_ID_INFO _id_container[SEEL_MAX_NODES];
     SEEL_Default_Queue<SEEL_ID_BCAST> _pending_bcast_ids;
     user_callback_broadcast_t _user_cb_broadcast;
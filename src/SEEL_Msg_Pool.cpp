@@ -0,0 +1,47 @@
+/*
+The SEEL repository can be found at: https://github.com/SEEL-Group/SEEL
+Copyright (C) SEEL Group 2021 all rights reserved
+See license file in root folder for more licensing details
+See SEEL_documentation.pdf for protocol description details
+
+File purpose:   See SEEL_Msg_Pool.h
+*/
+
+#include "SEEL_Msg_Pool.h"
+
+SEEL_Msg_Pool::SEEL_Msg_Pool(SEEL_Message* msgs, uint8_t* refs, uint8_t size)
+    : _msgs(msgs), _refs(refs), _size(size), _available(size)
+{
+    memset(_refs, 0, sizeof(_refs[0]) * _size);
+}
+
+SEEL_Msg_Handle SEEL_Msg_Pool::alloc()
+{
+    for (uint8_t i = 0; i < _size; ++i)
+    {
+        if (_refs[i] == 0)
+        {
+            _refs[i] = 1;
+            --_available;
+            return i;
+        }
+    }
+    return SEEL_MSG_NO_HANDLE;
+}
+
+void SEEL_Msg_Pool::retain(SEEL_Msg_Handle handle)
+{
+    ++_refs[handle];
+}
+
+void SEEL_Msg_Pool::release(SEEL_Msg_Handle handle)
+{
+    if (handle == SEEL_MSG_NO_HANDLE || _refs[handle] == 0)
+    {
+        return;
+    }
+    if (--_refs[handle] == 0)
+    {
+        ++_available;
+    }
+}
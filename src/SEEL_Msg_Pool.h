@@ -0,0 +1,65 @@
+/*
+The SEEL repository can be found at: https://github.com/SEEL-Group/SEEL
+Copyright (C) SEEL Group 2021 all rights reserved
+See license file in root folder for more licensing details
+See SEEL_documentation.pdf for protocol description details
+
+File purpose:   Fixed pool of SEEL msgs referenced through small handles
+*/
+
+#ifndef SEEL_Msg_Pool_h
+#define SEEL_Msg_Pool_h
+
+#include "SEEL_Defines.h"
+
+// Index of a msg in a SEEL_Msg_Pool
+typedef uint8_t SEEL_Msg_Handle;
+const SEEL_Msg_Handle SEEL_MSG_NO_HANDLE = UINT8_MAX;
+
+// Msgs are shared by handle between the receive ring, data queue and transmitter instead of being copied
+// Each msg is reference counted: alloc() returns a handle holding one reference, retain() adds one and
+// release() drops one. The msg returns to the pool once no references are left
+// alloc(), retain() and release() must not be called from interrupt context; get() may be
+class SEEL_Msg_Pool
+{
+public:
+    // Returns the msg referenced by "handle"
+    SEEL_Message* get(SEEL_Msg_Handle handle) {return &_msgs[handle];}
+
+    // Returns a handle to an unused msg, SEEL_MSG_NO_HANDLE if the pool is exhausted
+    // The contents of the msg are left as is
+    SEEL_Msg_Handle alloc();
+
+    // Adds a reference to "handle"
+    void retain(SEEL_Msg_Handle handle);
+
+    // Drops a reference to "handle", SEEL_MSG_NO_HANDLE is ignored
+    void release(SEEL_Msg_Handle handle);
+
+    uint8_t available() {return _available;}
+    uint8_t max_size() {return _size;}
+
+protected:
+    // Storage is provided by SEEL_Msg_Pool_Storage
+    SEEL_Msg_Pool(SEEL_Message* msgs, uint8_t* refs, uint8_t size);
+
+private:
+    SEEL_Message* _msgs;
+    uint8_t* _refs;
+    uint8_t _size;
+    uint8_t _available;
+};
+
+// Pool of N msgs, storage is part of the object
+template <uint8_t N>
+class SEEL_Msg_Pool_Storage : public SEEL_Msg_Pool
+{
+    static_assert(N > 0 && N < SEEL_MSG_NO_HANDLE, "SEEL_Msg_Pool size must be between 1 and 254");
+public:
+    SEEL_Msg_Pool_Storage() : SEEL_Msg_Pool(_msg_ary, _ref_ary, N) {}
+private:
+    SEEL_Message _msg_ary[N];
+    uint8_t _ref_ary[N];
+};
+
+#endif // SEEL_Msg_Pool_h
@@ -9,27 +9,56 @@ File purpose:   See SEEL_Node.h
 
 #include "SEEL_Node.h"
 
-void SEEL_Node::init(uint32_t n_id, uint32_t ts)
+SEEL_Node* SEEL_Node::_isr_inst = NULL;
+
+void SEEL_Node::init(uint32_t n_id, uint32_t ts, SEEL_Msg_Pool* msg_pool)
 {
-    SEEL_Print::print(F("SEEL Node ID: ")); SEEL_Print::println(n_id);
-    if (SEEL_TDMA_USE_TDMA)
+    if (SEEL_Print::enabled(SEEL_LOG_ROUTING, SEEL_LOG_LEVEL_INFO))
     {
-        SEEL_Print::print(F("SEEL TDMA Slot: ")); SEEL_Print::println(ts);
+        SEEL_Print::print(F("SEEL Node ID: ")); SEEL_Print::println(n_id);
+        if (SEEL_MAC::TIME_SLOTTED)
+        {
+            SEEL_Print::print(F("SEEL TDMA Slot: ")); SEEL_Print::println(ts);
+        }
     }
 
     _node_id = n_id;
     _tdma_slot = ts;
-    _prev_tdma_slot = 0;
-    if (_tdma_slot >= SEEL_TDMA_SLOTS && SEEL_TDMA_USE_TDMA)
+    if (_tdma_slot >= SEEL_TDMA_SLOTS && SEEL_MAC::TIME_SLOTTED)
     {
-        SEEL_Print::println(F("Error - TDMA Slot Overflow")); // Error - TDMA SLOTS Overflow
+        if (SEEL_Print::enabled(SEEL_LOG_RADIO, SEEL_LOG_LEVEL_ERROR))
+        {
+            SEEL_Print::println(F("Error - TDMA Slot Overflow")); // Error - TDMA SLOTS Overflow
+        }
         SEEL_Assert::assert(false, SEEL_ASSERT_FILE_NUM_NODE, __LINE__);
     }
 
     _id_verified = true;
-    _tranmission_ToA = SEEL_TRANSMISSION_UB_DUR_MILLIS; // Set to upperbound initially and adjust dynamically
-
-    _task_send.set_inst(this);
+    _rx_overflows = 0;
+    _tx_busy = false;
+    _send_parked = false;
+    _tx_done = false;
+    _tranmission_ToA = SEEL_TRANSMISSION_TOA_MILLIS; // Set to computed ToA initially and adjust dynamically
+
+    // Every receive ring slot holds a pool msg for the receive ISR to fill
+    _msg_pool_ptr = msg_pool;
+    for (uint8_t i = 0; i < SEEL_RX_RING_SIZE; ++i)
+    {
+        _rx_ring.slot(i)->handle = _msg_pool_ptr->alloc();
+        SEEL_Assert::assert(_rx_ring.slot(i)->handle != SEEL_MSG_NO_HANDLE, SEEL_ASSERT_FILE_NUM_NODE, __LINE__);
+    }
+    _bcast_handle = SEEL_MSG_NO_HANDLE;
+    _tx_handle = SEEL_MSG_NO_HANDLE;
+
+    _task_send.set_inst(this, SEEL_MAC::TIME_SLOTTED ? SEEL_Task::PRIORITY_CRITICAL : SEEL_Task::PRIORITY_SYSTEM); // Only TDMA sends are bound to a time window
+    _task_tx_done.set_inst(this);
+#if SEEL_RX_GATE_ENABLE
+    _task_rx_gate.set_inst(this, SEEL_Task::PRIORITY_CRITICAL); // Slot edges are time bound like TDMA sends
+    _rx_slot_mask = 0;
+    _rx_slot_mask_prev = 0;
+    _rx_parent_slot = SEEL_TDMA_SLOTS;
+    _rx_gate_open = true;
+#endif // SEEL_RX_GATE_ENABLE
 }
 
 void SEEL_Node::rfm_param_init(uint8_t cs_pin, uint8_t reset_pin, uint8_t int_pin, uint8_t TX_power, uint8_t coding_rate)
@@ -40,11 +69,17 @@ void SEEL_Node::rfm_param_init(uint8_t cs_pin, uint8_t reset_pin, uint8_t int_pi
 
     if (_LoRaPHY_ptr->begin(SEEL_RFM95_FREQ))
     {
-        SEEL_Print::println(F("LoRaPHY Init Success"));
+        if (SEEL_Print::enabled(SEEL_LOG_RADIO, SEEL_LOG_LEVEL_INFO))
+        {
+            SEEL_Print::println(F("LoRaPHY Init Success"));
+        }
     }
     else
     {
-        SEEL_Print::println(F("LoRaPHY Init Fail"));
+        if (SEEL_Print::enabled(SEEL_LOG_RADIO, SEEL_LOG_LEVEL_ERROR))
+        {
+            SEEL_Print::println(F("LoRaPHY Init Fail"));
+        }
         SEEL_Assert::assert(false, SEEL_ASSERT_FILE_NUM_NODE, __LINE__);
     }
 
@@ -53,18 +88,82 @@ void SEEL_Node::rfm_param_init(uint8_t cs_pin, uint8_t reset_pin, uint8_t int_pi
     _LoRaPHY_ptr->setSignalBandwidth(SEEL_RFM95_BW);
     _LoRaPHY_ptr->setTxPower(TX_power, PA_OUTPUT_PA_BOOST_PIN);
     _LoRaPHY_ptr->setCodingRate4(coding_rate);
+    // Receivers program the longest preamble they may receive, see SEEL_CAD_ENABLE
+    _LoRaPHY_ptr->setPreambleLength(SEEL_CAD_ENABLE ? SEEL_CAD_BCAST_PREAMBLE_LEN : SEEL_RFM95_PREAMBLE_LEN);
 
-    SEEL_Print::println(F("Parameters:"));
-    SEEL_Print::print(F("\tFq: ")); SEEL_Print::println(SEEL_RFM95_FREQ);
-    SEEL_Print::print(F("\tSF: ")); SEEL_Print::println(SEEL_RFM95_SF);
-    SEEL_Print::print(F("\tBW: ")); SEEL_Print::println(SEEL_RFM95_BW);
-    SEEL_Print::print(F("\tTX: ")); SEEL_Print::println(TX_power);
-    SEEL_Print::print(F("\tCR: ")); SEEL_Print::println(coding_rate);
-    SEEL_Print::print(F("\tPayload Size: ")); SEEL_Print::println(SEEL_MSG_TOTAL_SIZE);
+    if (SEEL_Print::enabled(SEEL_LOG_RADIO, SEEL_LOG_LEVEL_INFO))
+    {
+        SEEL_Print::println(F("Parameters:"));
+        SEEL_Print::print(F("\tFq: ")); SEEL_Print::println(SEEL_RFM95_FREQ);
+        SEEL_Print::print(F("\tSF: ")); SEEL_Print::println(SEEL_RFM95_SF);
+        SEEL_Print::print(F("\tBW: ")); SEEL_Print::println(SEEL_RFM95_BW);
+        SEEL_Print::print(F("\tTX: ")); SEEL_Print::println(TX_power);
+        SEEL_Print::print(F("\tCR: ")); SEEL_Print::println(coding_rate);
+        SEEL_Print::print(F("\tPayload Size: ")); SEEL_Print::println(SEEL_MSG_TOTAL_SIZE);
+        SEEL_Print::print(F("\tToA: ")); SEEL_Print::println(SEEL_TRANSMISSION_TOA_MILLIS);
+    }
 
     _LoRaPHY_ptr->enableCrc(); // Checks for bit flips to reduce erroneous packets received (16bit overhead)
+
+    // Packets are captured on RxDone (DIO0) interrupt; transceiver stays idle until rfm_receive_start()
+    _isr_inst = this;
+    _LoRaPHY_ptr->onReceive(rfm_receive_isr);
+    _LoRaPHY_ptr->onTxDone(rfm_tx_done_isr);
+#if SEEL_CAD_ENABLE
+    _LoRaPHY_ptr->onCadDone(rfm_cad_done_isr);
+#endif // SEEL_CAD_ENABLE
+}
+
+void SEEL_Node::rfm_receive_start()
+{
+    _rx_ring.clear(); // Drop packets captured before this point (e.g. previous cycle)
+#if SEEL_RX_GATE_ENABLE
+    _rx_gate_open = true;
+#endif // SEEL_RX_GATE_ENABLE
+    _LoRaPHY_ptr->receive();
+}
+
+void SEEL_Node::rfm_receive_resume()
+{
+#if SEEL_CAD_ENABLE
+    _LoRaPHY_ptr->setPreambleLength(SEEL_CAD_BCAST_PREAMBLE_LEN); // Set to the sent msg's length by rfm_send_msg()
+#endif // SEEL_CAD_ENABLE
+#if SEEL_RX_GATE_ENABLE
+    if (!_rx_gate_open)
+    {
+        _LoRaPHY_ptr->sleep();
+        return;
+    }
+#endif // SEEL_RX_GATE_ENABLE
+    _LoRaPHY_ptr->receive();
+}
+
+#if SEEL_CAD_ENABLE
+void SEEL_Node::rfm_cad_start()
+{
+    _cad_done = false;
+    _LoRaPHY_ptr->channelActivityDetection();
 }
 
+void SEEL_Node::rfm_cad_done_isr(bool detected)
+{
+    SEEL_Node* inst = _isr_inst;
+    inst->_cad_detected = detected;
+    inst->_cad_done = true;
+
+    // Receive right away on activity, the rest of the preamble is still on air
+    if (detected)
+    {
+        inst->_LoRaPHY_ptr->receive();
+    }
+    else
+    {
+        inst->_LoRaPHY_ptr->sleep();
+    }
+    inst->_ref_scheduler->raise_event(SEEL_SCHED_EVENT_CAD_DONE);
+}
+#endif // SEEL_CAD_ENABLE
+
 void SEEL_Node::create_msg(SEEL_Message* msg, const uint8_t targ_id, 
     const uint8_t cmd)
 {
@@ -92,37 +191,214 @@ void SEEL_Node::buf_to_SEEL_msg(SEEL_Message* msg, uint8_t const * buf)
     memcpy(msg->data, buf+SEEL_MSG_MISC_INDEX, SEEL_MSG_DATA_SIZE*sizeof(*buf));
 }
 
-bool SEEL_Node::rfm_send_msg(SEEL_Message* msg, uint8_t seq_num)
+bool SEEL_Node::rfm_send_msg(SEEL_Msg_Handle handle, uint8_t seq_num, SEEL_Trans_Type type)
 {
-    uint32_t send_time_start = millis();
-    
+    if (rfm_tx_busy())
+    {
+        if (SEEL_Print::enabled(SEEL_LOG_RADIO, SEEL_LOG_LEVEL_ERROR))
+        {
+            SEEL_Print::println(F("Error: Transceiver busy"));
+        }
+        return false;
+    }
+
+    SEEL_Message* msg = _msg_pool_ptr->get(handle);
     msg->seq_num = seq_num;
 
     if (!_LoRaPHY_ptr->beginPacket()) // true sets implicit header mode (no payload length, CR, CRC present info)
     {
-        SEEL_Print::println(F("Error: Transceiver not ready to send"));
+        if (SEEL_Print::enabled(SEEL_LOG_RADIO, SEEL_LOG_LEVEL_ERROR))
+        {
+            SEEL_Print::println(F("Error: Transceiver not ready to send"));
+        }
         return false;
     }
+#if SEEL_CAD_ENABLE
+    // Only bcasts need a preamble long enough to be caught by CAD
+    _LoRaPHY_ptr->setPreambleLength((msg->cmd == SEEL_CMD_BCAST) ? SEEL_CAD_BCAST_PREAMBLE_LEN : SEEL_RFM95_PREAMBLE_LEN);
+#endif // SEEL_CAD_ENABLE
     _LoRaPHY_ptr->write((uint8_t *)msg, SEEL_MSG_TOTAL_SIZE);
-    if (!_LoRaPHY_ptr->endPacket(false)) // false sets async mode, code blocks here until msg sent
+
+    _msg_pool_ptr->retain(handle);
+    _tx_handle = handle;
+    _tx_type = type;
+    _tx_done = false;
+    _tx_busy = true;
+    _tx_start_time = millis();
+    if (!_LoRaPHY_ptr->endPacket(true)) // true sets async mode, rfm_tx_done_isr() runs once msg is sent
     {
-        SEEL_Print::println(F("Error: Transceiver send failure"));
+        _tx_busy = false;
+        _msg_pool_ptr->release(_tx_handle);
+        rfm_receive_resume();
+        if (SEEL_Print::enabled(SEEL_LOG_RADIO, SEEL_LOG_LEVEL_ERROR))
+        {
+            SEEL_Print::println(F("Error: Transceiver send failure"));
+        }
         return false;
     }
 
+    return true; // Message is being sent out
+}
+
+uint32_t SEEL_Node::rfm_tx_remaining_millis()
+{
+    uint32_t elapsed_millis = millis() - _tx_start_time;
+    return (elapsed_millis < _tranmission_ToA) ? _tranmission_ToA - elapsed_millis : 1;
+}
+
+bool SEEL_Node::rfm_tx_busy()
+{
+    if (!_tx_busy)
+    {
+        return false;
+    }
+
+    if (_tx_done)
+    {
+        rfm_tx_complete();
+        return false;
+    }
+
+    if (millis() - _tx_start_time > SEEL_TRANSMISSION_TIMEOUT_MILLIS)
+    {
+        // TxDone never arrived, abort the transmission; msg is treated as not sent
+        if (SEEL_Print::enabled(SEEL_LOG_RADIO, SEEL_LOG_LEVEL_ERROR))
+        {
+            SEEL_Print::println(F("Error: Transceiver send timeout"));
+        }
+        _LoRaPHY_ptr->idle();
+        rfm_receive_resume();
+        _tx_busy = false;
+        _msg_pool_ptr->release(_tx_handle);
+        return false;
+    }
+
+    return true;
+}
+
+void SEEL_Node::rfm_tx_done_isr()
+{
+    SEEL_Node* inst = _isr_inst;
+    inst->_tx_done_time = millis();
+    inst->_tx_done = true;
+
+    // Transceiver returns to standby after TX, go back to receive
+    inst->rfm_receive_resume();
+    inst->_ref_scheduler->raise_event(SEEL_SCHED_EVENT_TX_DONE);
+}
+
+void SEEL_Node::rfm_tx_complete()
+{
+    _tx_busy = false;
+    _tx_done = false;
+
     // ToA should be consistent among transmissions since packet size and LoRa parameters are fixed
-    _tranmission_ToA = millis() - send_time_start;
-    SEEL_Print::print(F("<<S: "));
-    print_msg(msg);
-    SEEL_Print::print(F(", Start Time: "));
-    SEEL_Print::print(send_time_start);
-    SEEL_Print::print(F(", ToA: ")); // Send duration (ToA, time in TX state) estimate
-    SEEL_Print::println(_tranmission_ToA);
-    SEEL_Print::flush();
+    // Bcasts are measured without their longer preamble, it is added back when sending a bcast
+    _tranmission_ToA = _tx_done_time - _tx_start_time;
+    if (_tx_type == TRANS_BCAST && _tranmission_ToA > SEEL_BCAST_EXTRA_TOA_MILLIS)
+    {
+        _tranmission_ToA -= SEEL_BCAST_EXTRA_TOA_MILLIS;
+    }
+    _cycle_transmissions.inc(_tx_type);
+
+    if (SEEL_Print::enabled(SEEL_LOG_RADIO, SEEL_LOG_LEVEL_INFO) && SEEL_Print::deferred())
+    {
+        uint8_t record[1 + SEEL_MSG_TOTAL_SIZE + 8];
+        record[0] = SEEL_LOG_EVENT_SEND;
+        memcpy(record + 1, _msg_pool_ptr->get(_tx_handle), SEEL_MSG_TOTAL_SIZE);
+        SEEL_Wire_BE<4>::set(record + 1 + SEEL_MSG_TOTAL_SIZE, _tx_start_time);
+        SEEL_Wire_BE<4>::set(record + 5 + SEEL_MSG_TOTAL_SIZE, _tranmission_ToA);
+        SEEL_Print::record(record, sizeof(record));
+    }
+    else if (SEEL_Print::enabled(SEEL_LOG_RADIO, SEEL_LOG_LEVEL_INFO))
+    {
+        SEEL_Print::print(F("<<S: "));
+        print_msg(_msg_pool_ptr->get(_tx_handle));
+        SEEL_Print::print(F(", Start Time: "));
+        SEEL_Print::print(_tx_start_time);
+        SEEL_Print::print(F(", ToA: ")); // Send duration (ToA, time in TX state)
+        SEEL_Print::println(_tranmission_ToA);
+        SEEL_Print::flush();
+    }
+
+    _msg_pool_ptr->release(_tx_handle);
+}
+
+void SEEL_Node::SEEL_Task_Node_Tx_Done::run()
+{
+    // Completes the transmission if a task has not already done so through rfm_tx_busy()
+    _inst->rfm_tx_busy();
+
+    bool added = _inst->_ref_scheduler->add_event_task(&_inst->_task_tx_done, SEEL_SCHED_EVENT_TX_DONE);
+    SEEL_Assert::assert(added, SEEL_ASSERT_FILE_NUM_NODE, __LINE__);
+}
+
+uint8_t SEEL_Node::rfm_rx_slot(uint32_t receive_offset)
+{
+    // Msgs start within the first SEEL_TDMA_BUFFER_MILLIS of a slot, the guard absorbs time sync error at the slot start
+    uint32_t sent_millis = _ref_scheduler->get_network_millis() - receive_offset - _tranmission_ToA;
+    return ((sent_millis + SEEL_RX_GATE_GUARD_MILLIS) % SEEL_TDMA_CYCLE_TIME_MILLIS) / SEEL_TDMA_SLOT_WAIT_MILLIS;
+}
+
+#if SEEL_RX_GATE_ENABLE
+void SEEL_Node::SEEL_Task_Node_Rx_Gate::run()
+{
+    // Slots are aligned to network time like in SEEL_MAC_TDMA::can_send()
+    // A slot's receive window starts SEEL_RX_GATE_GUARD_MILLIS before the slot and ends as long after it
+    uint32_t cycle_millis = _inst->_ref_scheduler->get_network_millis() % SEEL_TDMA_CYCLE_TIME_MILLIS;
+    uint8_t slot = cycle_millis / SEEL_TDMA_SLOT_WAIT_MILLIS;
+    uint32_t slot_millis = cycle_millis % SEEL_TDMA_SLOT_WAIT_MILLIS;
+    uint8_t prev_slot = (slot == 0) ? SEEL_TDMA_SLOTS - 1 : slot - 1;
+    uint8_t next_slot = (slot + 1 == SEEL_TDMA_SLOTS) ? 0 : slot + 1;
+
+    bool open = _inst->rx_slot_needed(slot);
+    uint32_t next_edge_millis;
+    if (slot_millis < SEEL_RX_GATE_GUARD_MILLIS)
+    {
+        open |= _inst->rx_slot_needed(prev_slot);
+        next_edge_millis = SEEL_RX_GATE_GUARD_MILLIS - slot_millis;
+    }
+    else if (slot_millis < SEEL_TDMA_SLOT_WAIT_MILLIS - SEEL_RX_GATE_GUARD_MILLIS)
+    {
+        next_edge_millis = SEEL_TDMA_SLOT_WAIT_MILLIS - SEEL_RX_GATE_GUARD_MILLIS - slot_millis;
+    }
+    else
+    {
+        open |= _inst->rx_slot_needed(next_slot);
+        next_edge_millis = SEEL_TDMA_SLOT_WAIT_MILLIS - slot_millis + SEEL_RX_GATE_GUARD_MILLIS;
+    }
+    _inst->rfm_rx_gate_set(open);
 
-    return true; // Message sent out
+    // Edges are re-evaluated, so msgs sent in between (e.g. awaiting an ACK) open the next matching window
+    _inst->_ref_scheduler->rearm_current_task(next_edge_millis);
 }
 
+bool SEEL_Node::rx_slot_needed(uint8_t slot)
+{
+    if (((_rx_slot_mask | _rx_slot_mask_prev) >> slot) & 1)
+    {
+        return true;
+    }
+    // The parent ACKs in its own slot; while its slot is unknown, every slot is kept open
+    return _unack_msgs > 0 && (_rx_parent_slot >= SEEL_TDMA_SLOTS || _rx_parent_slot == slot);
+}
+
+void SEEL_Node::rfm_rx_gate_set(bool open)
+{
+    if (_rx_gate_open == open)
+    {
+        return;
+    }
+    _rx_gate_open = open;
+
+    // rfm_tx_done_isr() applies the new state once the transmission is done
+    if (!rfm_tx_busy())
+    {
+        rfm_receive_resume();
+    }
+}
+#endif // SEEL_RX_GATE_ENABLE
+
 bool SEEL_Node::dup_msg_check(SEEL_Message* msg)
 {
     // Check if there are any matches in dup array
@@ -161,62 +437,178 @@ bool SEEL_Node::dup_msg_check(SEEL_Message* msg)
     return message_duplicate;
 }
 
-// Return RSSI through pass by reference via "rssi"
-// and time taken in this method via "buf_cpy_time"
-bool SEEL_Node::rfm_receive_msg(SEEL_Message* msg, int8_t& rssi, uint32_t& method_time)
+void SEEL_Node::rfm_strip_cmd_flags(SEEL_Rx_Packet* packet, SEEL_Message* msg)
 {
-    bool valid_msg = false;
-    bool crc_valid = true;
+    packet->subtree_done = (msg->cmd & SEEL_CMD_FLAG_SUBTREE_DONE) != 0;
+    msg->cmd &= ~SEEL_CMD_FLAG_SUBTREE_DONE;
+}
 
-    uint8_t msg_len = _LoRaPHY_ptr->parsePacket(crc_valid, 0); // TODO: Requires modified version of LoRa lib to get crc_valid info, see comment below
-    // Apply patch from SEEL/patches using "git apply <patch>" to the *** Arduino LoRa ** library
+void SEEL_Node::rfm_receive_isr(int packet_size)
+{
+    SEEL_Node* inst = _isr_inst;
+    LoRaClass* phy = inst->_LoRaPHY_ptr;
+    SEEL_Rx_Packet* packet = inst->_rx_ring.push_slot();
+    if (packet == NULL)
+    {
+        // Receive task has fallen behind, packet is dropped (FIFO is overwritten by the next reception)
+        ++inst->_rx_overflows;
+        return;
+    }
 
-    if (msg_len > 0) // Message is available
-    { 
-        float snr = 0.0f;
-        uint32_t receive_time = millis();
-        uint8_t buf[SEEL_MSG_TOTAL_SIZE];
+    // SEEL_Message matches the wire layout, so the FIFO is read directly into the slot's pool msg
+    SEEL_Message* msg = inst->_msg_pool_ptr->get(packet->handle);
+    uint8_t* dest = (uint8_t*)msg;
+    uint8_t read_len = min(packet_size, SEEL_MSG_TOTAL_SIZE);
+    uint8_t read_index = 0;
+    packet->subtree_done = false;
 
-        SEEL_Print::print((crc_valid) ? F(">>R: ") : F(">>CRC FAIL: "));
-        for (uint8_t i = 0; i < min(msg_len, SEEL_MSG_TOTAL_SIZE); ++i)
+    if (SEEL_RX_HEADER_FILTER_ENABLE)
+    {
+        // Non-SEEL packets are dropped without reading the FIFO
+        if (packet_size != SEEL_MSG_TOTAL_SIZE)
         {
-            buf[i] = _LoRaPHY_ptr->read();
+            return;
         }
-        rssi = _LoRaPHY_ptr->packetRssi();
-        snr = _LoRaPHY_ptr->packetSnr();
-
-        // Converts raw msg buffer to SEEL_Message
-        buf_to_SEEL_msg(msg, buf);
 
-        // Check if the message has already been seen, to prevent a loop
-        if (!crc_valid) {
-            ++_CRC_fails; // Number of packets RECEIVED with invalid CRC
-        }
-        else if (dup_msg_check(msg)) {
-            SEEL_Print::println(F("Duplicate message")); 
-            SEEL_Node::set_flag(SEEL_Flags::FLAG_DUP_MSG);
+        // Read the header only, the payload of msgs not meant for this node is never read
+        for (; read_index < SEEL_MSG_HEADER_SIZE; ++read_index)
+        {
+            dest[read_index] = phy->read();
         }
-        else if (msg_len != SEEL_MSG_TOTAL_SIZE) {
-            SEEL_Print::println(F("Wrong length message")); // Could be from external LoRa transmission
+        rfm_strip_cmd_flags(packet, msg);
+        if (!inst->rfm_header_accept(msg))
+        {
+            return; // Slot was not committed, it is reused for the next packet
         }
-        else {
-            valid_msg = true;
+    }
+
+    for (; read_index < read_len; ++read_index)
+    {
+        dest[read_index] = phy->read();
+    }
+    if (!SEEL_RX_HEADER_FILTER_ENABLE)
+    {
+        rfm_strip_cmd_flags(packet, msg);
+    }
+    packet->receive_time = millis();
+    packet->len = min(packet_size, UINT8_MAX);
+    packet->rssi = phy->packetRssi();
+    packet->snr = phy->packetSnr();
+
+    inst->_rx_ring.push_commit();
+    inst->_ref_scheduler->raise_event(SEEL_SCHED_EVENT_RX);
+}
+
+// Return RSSI through pass by reference via "rssi"
+// and time since the packet was received via "receive_offset"
+SEEL_Message* SEEL_Node::rfm_receive_msg(int8_t& rssi, uint32_t& receive_offset)
+{
+    SEEL_Rx_Packet* packet = _rx_ring.front();
+    if (packet == NULL) // No message available
+    {
+        return NULL;
+    }
+
+    if (_rx_overflows > 0)
+    {
+        cli();
+        uint8_t overflows = _rx_overflows;
+        _rx_overflows = 0;
+        sei();
+        if (SEEL_Print::enabled(SEEL_LOG_RADIO, SEEL_LOG_LEVEL_ERROR))
+        {
+            SEEL_Print::print(F("Receive overflow, dropped: "));
+            SEEL_Print::println(overflows);
         }
+    }
 
-        method_time = millis() - receive_time;
+    // Msg is used in place, slot is released to the ISR in rfm_receive_release()
+    // Note: Packets failing CRC are discarded by the LoRa library before reaching the ISR
+    SEEL_Message* msg = _msg_pool_ptr->get(packet->handle);
+    bool valid_msg = false;
+    rssi = packet->rssi;
+
+    // Check if the message has already been seen, to prevent a loop
+    bool duplicate = dup_msg_check(msg);
+    if (duplicate) {
+        SEEL_Node::set_flag(SEEL_Flags::FLAG_DUP_MSG);
+    }
+    else if (packet->len == SEEL_MSG_TOTAL_SIZE) { // Otherwise could be from external LoRa transmission
+        valid_msg = true;
+    }
+
+    receive_offset = millis() - packet->receive_time;
+    if (SEEL_Print::enabled(SEEL_LOG_RADIO, SEEL_LOG_LEVEL_INFO) && SEEL_Print::deferred())
+    {
+        uint8_t record[1 + 1 + SEEL_MSG_TOTAL_SIZE + 7];
+        record[0] = SEEL_LOG_EVENT_RECEIVE;
+        record[1] = duplicate ? SEEL_LOG_RX_DUPLICATE : (valid_msg ? SEEL_LOG_RX_VALID : SEEL_LOG_RX_WRONG_LENGTH);
+        memcpy(record + 2, msg, SEEL_MSG_TOTAL_SIZE);
+        record[2 + SEEL_MSG_TOTAL_SIZE] = packet->len;
+        record[3 + SEEL_MSG_TOTAL_SIZE] = (uint8_t) (int8_t) (packet->snr * 4); // SNR has 0.25 dB steps
+        record[4 + SEEL_MSG_TOTAL_SIZE] = (uint8_t) rssi;
+        SEEL_Wire_BE<4>::set(record + 5 + SEEL_MSG_TOTAL_SIZE, receive_offset);
+        SEEL_Print::record(record, sizeof(record));
+    }
+    else if (SEEL_Print::enabled(SEEL_LOG_RADIO, SEEL_LOG_LEVEL_INFO))
+    {
+        SEEL_Print::print(F(">>R: "));
+        if (duplicate) {
+            SEEL_Print::println(F("Duplicate message"));
+        }
+        else if (!valid_msg) {
+            SEEL_Print::println(F("Wrong length message"));
+        }
         print_msg(msg);
         SEEL_Print::print(F("Len: "));
-        SEEL_Print::print(msg_len);
+        SEEL_Print::print(packet->len);
         SEEL_Print::print(F(", SNR: "));
-        SEEL_Print::print(snr);
+        SEEL_Print::print(packet->snr);
         SEEL_Print::print(F(", RSSI: "));
         SEEL_Print::print(rssi);
         SEEL_Print::print(F(", Rec. Time: "));
-        SEEL_Print::println(method_time);
+        SEEL_Print::println(receive_offset);
         SEEL_Print::flush();
     }
     
-    return valid_msg;
+    return valid_msg ? msg : NULL;
+}
+
+SEEL_Msg_Handle SEEL_Node::rfm_receive_adopt()
+{
+    SEEL_Rx_Packet* packet = _rx_ring.front();
+    SEEL_Msg_Handle fresh = _msg_pool_ptr->alloc();
+    if (packet == NULL || fresh == SEEL_MSG_NO_HANDLE)
+    {
+        _msg_pool_ptr->release(fresh);
+        return SEEL_MSG_NO_HANDLE;
+    }
+
+    SEEL_Msg_Handle adopted = packet->handle;
+    packet->handle = fresh;
+    return adopted;
+}
+
+void SEEL_Node::send_start()
+{
+    _send_parked = false;
+    _send_handle = _ref_scheduler->add_periodic_task(&_task_send, 0);
+    SEEL_Assert::assert(_send_handle, SEEL_ASSERT_FILE_NUM_NODE, __LINE__);
+}
+
+void SEEL_Node::send_ready()
+{
+    if (_send_parked)
+    {
+        _send_parked = false;
+        _ref_scheduler->reschedule_task(_send_handle, 0);
+    }
+}
+
+bool SEEL_Node::send_pending()
+{
+    return (_bcast_avail && !_bcast_sent) || !_ack_queue.empty() ||
+        (_parent_lock && _data_queue_ptr != NULL && !_data_queue_ptr->empty());
 }
 
 void SEEL_Node::enqueue_ack(SEEL_Message* prev_msg)
@@ -227,10 +619,14 @@ void SEEL_Node::enqueue_ack(SEEL_Message* prev_msg)
     {
         bool added = _ack_queue.add(prev_msg->send_id);
         if (added) {
-        SEEL_Print::print(F("Enqueue ACK message: "));
-        _ack_queue.print();
+            send_ready();
+            if (SEEL_Print::enabled(SEEL_LOG_QUEUE, SEEL_LOG_LEVEL_DEBUG))
+            {
+                SEEL_Print::print(F("Enqueue ACK message: "));
+                _ack_queue.print();
+            }
         }
-        else {
+        else if (SEEL_Print::enabled(SEEL_LOG_QUEUE, SEEL_LOG_LEVEL_ERROR)) {
             SEEL_Print::println(F("ACK message not added"));
         }
     }
@@ -245,9 +641,9 @@ void SEEL_Node::print_msg(SEEL_Message* msg)
     }
 }
 
-bool SEEL_Node::try_send(SEEL_Message* to_send_ptr, bool seq_inc)
+bool SEEL_Node::try_send(SEEL_Msg_Handle handle, bool seq_inc, SEEL_Trans_Type type)
 {
-    uint8_t seq_num = to_send_ptr->seq_num;
+    uint8_t seq_num = _msg_pool_ptr->get(handle)->seq_num;
     // Increment sequence numbers for messages sent by this node
     if (seq_inc)
     {
@@ -257,14 +653,10 @@ bool SEEL_Node::try_send(SEEL_Message* to_send_ptr, bool seq_inc)
 
     // Not waiting for ack or wait has timed out
     // If timed out, re-send the same message because it has not been popped
-    if (rfm_send_msg(to_send_ptr, seq_num))
+    if (rfm_send_msg(handle, seq_num, type))
     {
-        // Code reaches here if msg was sent out
-        if (!SEEL_TDMA_USE_TDMA)
-        {
-            _last_msg_sent_time = millis();
-            _msg_send_delay = random(SEEL_EB_MIN_MILLIS, SEEL_EB_INIT_MILLIS * pow(SEEL_EB_EXP_SCALE, _unack_msgs));
-        }
+        // Code reaches here if msg is being sent out
+        _mac.on_sent(_unack_msgs);
         return true;
     }
     // Message failed to send
@@ -273,69 +665,74 @@ bool SEEL_Node::try_send(SEEL_Message* to_send_ptr, bool seq_inc)
 
 void SEEL_Node::SEEL_Task_Node_Send::run()
 {
-    bool can_send = true;
-    uint32_t time_millis = millis();
-
-    // Select which collision avoidance strategy to use
-    if (SEEL_TDMA_USE_TDMA)
+    // Periodic task (period 0) until the scheduler is cleared, every wait below re-arms it so the scheduler can idle
+    // With TDMA, the task re-arms itself to the start of its next slot while outside of its slot
+    // Wait for the previous transmission to finish
+    if (_inst->rfm_tx_busy())
     {
-        uint8_t current_slot = (time_millis % SEEL_TDMA_CYCLE_TIME_MILLIS) / SEEL_TDMA_SLOT_WAIT_MILLIS;
-
-        // Compare with buffer because NODE should not send message if the msg is expected to finish after the slot
-        can_send = (current_slot == _inst->_tdma_slot) && ((time_millis % SEEL_TDMA_SLOT_WAIT_MILLIS) < SEEL_TDMA_BUFFER_MILLIS);
-        if (SEEL_TDMA_SINGLE_SEND && can_send)
-        {
-            // Only send on first instance of slot change
-            can_send = (_inst->_prev_tdma_slot != current_slot);
-        }
+        _inst->_ref_scheduler->rearm_current_task(_inst->rfm_tx_remaining_millis());
+        return;
+    }
 
-        _inst->_prev_tdma_slot = current_slot;
+    // Nothing to send, park until send_ready()
+    if (!_inst->send_pending())
+    {
+        _inst->_send_parked = true;
+        _inst->_ref_scheduler->rearm_current_task(SEEL_SEND_PARK_MILLIS);
+        return;
     }
-    else // Exponential Backoff
+
+    // An ACK msg is taken from the pool; check before can_send(), which may re-arm this task to the next TDMA slot
+    // so a momentary pool shortage is retried shortly instead of giving up the slot
+    if (!(_inst->_bcast_avail && !_inst->_bcast_sent) && !_inst->_ack_queue.empty() && _inst->_msg_pool_ptr->available() == 0)
     {
-        can_send = (time_millis - _inst->_last_msg_sent_time) > _inst->_msg_send_delay;
+        _inst->_ref_scheduler->rearm_current_task(1);
+        return;
     }
 
-    // If cannot send or nothing to send, return
-    if (!can_send || (!_inst->_bcast_avail && _inst->_ack_queue.empty() && _inst->_data_queue_ptr != NULL && _inst->_data_queue_ptr->empty()))
+    // If cannot send, can_send() re-armed the task to the next time a msg may be sent
+    if (!_inst->_mac.can_send(_inst->_ref_scheduler, _inst->_tdma_slot))
     {
-        bool added = _inst->_ref_scheduler->add_task(&_inst->_task_send);
-        SEEL_Assert::assert(added, SEEL_ASSERT_FILE_NUM_NODE, __LINE__);
         return;
     }
     // If the code reaches here, a message can be sent out
-    SEEL_Message to_send;
-    SEEL_Message* to_send_ptr = &to_send;
+    // Msgs are sent from the pool in place; rfm_send_msg() keeps its own reference until TX completes
+    SEEL_Message* to_send_ptr;
 
     // Prioritize bcast msgs, then ack msgs, then data/id_check msgs
     // Note messages in _data_queue_ptr may be from previous cycles
     // Send only one bcast msg per cycle to avoid pollution
     if (_inst->_bcast_avail && !_inst->_bcast_sent)
     {
-        to_send_ptr = &_inst->_bcast_msg;
+        to_send_ptr = _inst->_msg_pool_ptr->get(_inst->_bcast_handle);
 
         to_send_ptr->send_id = _inst->_node_id;
 
-        to_send_ptr->data[SEEL_MSG_DATA_HOP_COUNT_INDEX] = _inst->_cb_info.hop_count;
-        to_send_ptr->data[SEEL_MSG_DATA_RSSI_INDEX] = _inst->_path_rssi;
+        SEEL_Wire_Bcast::Hop_Count::set(to_send_ptr->data, _inst->_cb_info.hop_count);
+        SEEL_Wire_Bcast::RSSI::set(to_send_ptr->data, (uint8_t) _inst->_path_rssi);
 
         // Update time info right before the send
-        uint32_t time_millis = millis();
-        time_millis += _inst->_tranmission_ToA; // account for transmission delay beforehand
-        to_send_ptr->data[SEEL_MSG_DATA_TIME_SYNC_INDEX] = (uint8_t) (time_millis >> 24);
-        to_send_ptr->data[SEEL_MSG_DATA_TIME_SYNC_INDEX + 1] = (uint8_t) (time_millis >> 16);
-        to_send_ptr->data[SEEL_MSG_DATA_TIME_SYNC_INDEX + 2] = (uint8_t) (time_millis >> 8);
-        to_send_ptr->data[SEEL_MSG_DATA_TIME_SYNC_INDEX + 3] = (uint8_t) (time_millis);
-
-        if (_inst->try_send(to_send_ptr, false))
+        uint32_t time_millis = _inst->_ref_scheduler->get_network_millis();
+        time_millis += _inst->_tranmission_ToA + SEEL_BCAST_EXTRA_TOA_MILLIS; // account for transmission delay beforehand
+        SEEL_Wire_Bcast::Time_Sync::set(to_send_ptr->data, time_millis);
+
+        if (_inst->try_send(_inst->_bcast_handle, false, TRANS_BCAST))
         {
+            _inst->_msg_pool_ptr->release(_inst->_bcast_handle);
+            _inst->_bcast_handle = SEEL_MSG_NO_HANDLE;
             _inst->_bcast_avail = false;
             _inst->_bcast_sent = true;
-            ++(_inst->_cycle_transmissions.bcast);
+            _inst->_ref_scheduler->raise_event(SEEL_SCHED_EVENT_BCAST_SENT);
         }
     }
     else if (!_inst->_ack_queue.empty())
     {
+        SEEL_Msg_Handle handle = _inst->_msg_pool_ptr->alloc();
+        if (handle == SEEL_MSG_NO_HANDLE)
+        {
+            return; // Not expected, the pool was checked before can_send()
+        }
+        to_send_ptr = _inst->_msg_pool_ptr->get(handle);
         memset(to_send_ptr->data, 0, sizeof(to_send_ptr->data[0]) * SEEL_MSG_DATA_SIZE);
         // Fill message with as many pending ACK's as possible
         for (uint32_t i = 0; i < SEEL_MSG_DATA_SIZE && !_inst->_ack_queue.empty(); ++i)
@@ -345,13 +742,13 @@ void SEEL_Node::SEEL_Task_Node_Send::run()
         }
         _inst->create_msg(to_send_ptr, SEEL_GNODE_ID, SEEL_CMD_ACK);
 
-        if (_inst->try_send(to_send_ptr, true)) {
-            ++(_inst->_cycle_transmissions.ack);
-        }
+        _inst->try_send(handle, true, TRANS_ACK);
+        _inst->_msg_pool_ptr->release(handle);
     }
     else if (_inst->_parent_lock && _inst->_data_queue_ptr != NULL && !_inst->_data_queue_ptr->empty())// DATA or ID_CHECK or FORWARDED message
     {
-        to_send_ptr = _inst->_data_queue_ptr->front();
+        SEEL_Msg_Handle handle = _inst->_data_queue_ptr->front_handle();
+        to_send_ptr = _inst->_msg_pool_ptr->get(handle);
         uint32_t msg_cmd = to_send_ptr->cmd;
 
         // Call presend callback on data messages
@@ -362,44 +759,40 @@ void SEEL_Node::SEEL_Task_Node_Send::run()
         // A verified node may still have an join requests in the message queue
         // If this node is already verified, then do not send and pop the join request from send queue
         else if (msg_cmd == SEEL_CMD_ID_CHECK &&
-            to_send_ptr->data[SEEL_MSG_DATA_ID_CHECK_INDEX] == _inst->_node_id && // Make sure check if for THIS node (not forwarde)
+            SEEL_Wire_ID_Check::ID::get(to_send_ptr->data) == _inst->_node_id && // Make sure check if for THIS node (not forwarde)
             _inst->_id_verified)
         {
             _inst->_data_queue_ptr->pop_front();
-            bool added = _inst->_ref_scheduler->add_task(&_inst->_task_send);
-            SEEL_Assert::assert(added, SEEL_ASSERT_FILE_NUM_NODE, __LINE__);
             return;
         }
 
-        uint32_t msg_original_send_id = to_send_ptr->send_id;
         // Any ID_CHECK or DATA msgs need to be sent to this node's parent at THIS cycle,
         // but queue'd messages might have different parents. So correct the parent at SEND time.
         // Same with self ID, node may take a suggested ID, so sender should also be corrected
         to_send_ptr->send_id = _inst->_node_id;
         to_send_ptr->targ_id = _inst->_parent_id;
 
-        if (_inst->try_send(to_send_ptr, true))
+        // Own msgs are marked when enqueued, orig_send_id may be an ID this node held before
+        SEEL_Trans_Type type = TRANS_FWD;
+        if (_inst->_data_queue_ptr->front_own())
+        {
+            type = (msg_cmd == SEEL_CMD_ID_CHECK) ? TRANS_ID_CHECK : TRANS_DATA;
+        }
+
+        // The flag is only set for this transmission, it is recomputed if the msg is sent again
+        if (SEEL_EARLY_SLEEP_ENABLE && _inst->subtree_done_hint())
+        {
+            to_send_ptr->cmd |= SEEL_CMD_FLAG_SUBTREE_DONE;
+        }
+        bool sent = _inst->try_send(handle, true, type);
+        to_send_ptr->cmd &= ~SEEL_CMD_FLAG_SUBTREE_DONE;
+        if (sent)
         {
             ++(_inst->_unack_msgs);
             ++(_inst->_failed_transmissions);
-            if (msg_original_send_id != _inst->_node_id) // Fwd msg
-            {
-                ++(_inst->_cycle_transmissions.fwd);
-            }
-            else if (msg_cmd == SEEL_CMD_DATA)
-            {
-                ++(_inst->_cycle_transmissions.data);
-            }
-            else if (msg_cmd == SEEL_CMD_ID_CHECK)
-            {
-                ++(_inst->_cycle_transmissions.id_check);
-            }
         }
         // Do not pop msg from queue until msg is ack'd
     }
-
-    bool added = _inst->_ref_scheduler->add_task(&_inst->_task_send);
-    SEEL_Assert::assert(added, SEEL_ASSERT_FILE_NUM_NODE, __LINE__);
 }
 
 void SEEL_Node::set_flag(SEEL_Flags flag) {
@@ -15,6 +15,9 @@ File purpose:   Base class for GNODE and SNODE
 
 #include "SEEL_Defines.h"
 #include "SEEL_Scheduler.h"
+#include "SEEL_Policies.h"
+#include "SEEL_Msg_Pool.h"
+#include "SEEL_Data_Queue.h"
 
 class SEEL_Node
 {
@@ -29,6 +32,15 @@ public:
         FLAG_ASSERT_FIRED = 3
     };
 
+    // Transmission types, selects which SEEL_Transmissions counter a completed send increments
+    enum SEEL_Trans_Type {
+        TRANS_BCAST,
+        TRANS_DATA,
+        TRANS_ID_CHECK,
+        TRANS_ACK,
+        TRANS_FWD
+    };
+
     class SEEL_Transmissions
     {
     public:
@@ -52,10 +64,28 @@ public:
             fwd = 0;
         }
         
+        void inc(SEEL_Trans_Type type)
+        {
+            switch (type)
+            {
+                case TRANS_BCAST: ++bcast; break;
+                case TRANS_DATA: ++data; break;
+                case TRANS_ID_CHECK: ++id_check; break;
+                case TRANS_ACK: ++ack; break;
+                case TRANS_FWD: ++fwd; break;
+            }
+        }
+
         uint16_t get_total_trans()
         {
             return (uint16_t)bcast + (uint16_t)data + (uint16_t)id_check + (uint16_t)ack + (uint16_t)fwd;
         }
+
+        // Transmissions that expect an ACK from the parent
+        uint16_t get_acked_trans()
+        {
+            return (uint16_t)data + (uint16_t)id_check + (uint16_t)fwd;
+        }
     };
 
     // Contains information that helps debugging the network after deployment.
@@ -78,6 +108,9 @@ public:
         uint8_t prev_flags; // prev cycle logging flags; see above enum for more information
         int8_t parent_rssi; // RSSI value of the bcast msg received from the parent, initialized to 0
         bool first_callback; // Whether this callback call is the first one this cycle (allows for initialization)
+#if SEEL_SCHED_STATS_ENABLE
+        SEEL_Scheduler::SEEL_Sched_Summary prev_sched_summary; // prev cycle scheduler loop rate, idle time, task lateness and run time
+#endif // SEEL_SCHED_STATS_ENABLE
 
         SEEL_CB_Info() : wtb_millis(0), prev_CRC_fails(0), hop_count(0), missed_bcasts(0), 
         missed_msgs(0), bcast_count(0), prev_flags(0), first_callback(false) {}
@@ -106,11 +139,25 @@ public:
     // Destructor
     virtual ~SEEL_Node() {_LoRaPHY_ptr->end();}
 protected:
+    // Structs & Classes
+
+    // Packet captured by the receive ISR, processed later by the receive task
+    struct SEEL_Rx_Packet
+    {
+        SEEL_Msg_Handle handle; // Pool msg the transceiver FIFO is read into
+        uint32_t receive_time; // millis() at RxDone
+        float snr;
+        int8_t rssi;
+        uint8_t len; // Received length, may differ from SEEL_MSG_TOTAL_SIZE if the packet is not a SEEL msg
+        bool subtree_done; // SEEL_CMD_FLAG_SUBTREE_DONE was set, the flag is cleared from the msg's cmd
+    };
+
+    // ***************************************************
     // Tasks
     class SEEL_Task_Node : public SEEL_Task
     {
     public:
-        void set_inst(SEEL_Node* inst) {_inst = inst; _user_task = false;}
+        void set_inst(SEEL_Node* inst, SEEL_Task_Priority priority = PRIORITY_SYSTEM) {_inst = inst; _priority = priority;}
     protected:
         SEEL_Task_Node() {} // Prevents class instantiation
         SEEL_Node* _inst;
@@ -122,26 +169,107 @@ protected:
     class SEEL_Task_Node_Send : public SEEL_Task_Node {virtual void run();};
     SEEL_Task_Node_Send _task_send;
 
+    // Completes a transmission started by rfm_send_msg(), runs when SEEL_SCHED_EVENT_TX_DONE is raised
+    class SEEL_Task_Node_Tx_Done : public SEEL_Task_Node {virtual void run();};
+    SEEL_Task_Node_Tx_Done _task_tx_done;
+
+#if SEEL_RX_GATE_ENABLE
+    // Switches the transceiver between receive and sleep at TDMA slot edges, see SEEL_RX_GATE_ENABLE
+    // Runs until the scheduler is cleared, receive is continuous until the task is first added
+    class SEEL_Task_Node_Rx_Gate : public SEEL_Task_Node {virtual void run();};
+    SEEL_Task_Node_Rx_Gate _task_rx_gate;
+#endif // SEEL_RX_GATE_ENABLE
+
     // ***************************************************
     // Member functions
 
     // Constructor
     SEEL_Node() {} // Having a protected constructor prevents instantiation of class
 
-    void init(uint32_t n_id, uint32_t ts);
+    // "msg_pool" provides all msg buffers of this NODE
+    void init(uint32_t n_id, uint32_t ts, SEEL_Msg_Pool* msg_pool);
 
     void rfm_param_init(uint8_t cs_pin, uint8_t reset_pin, uint8_t int_pin, uint8_t TX_power, uint8_t coding_rate);
 
-    // Returns if message was sent out
-    bool rfm_send_msg(SEEL_Message* rfm_send_msg, uint8_t seq_num);
+    // Starts transmitting the msg and returns without waiting for TX to finish
+    // Returns if the transmission was started; "type" counter is incremented once TX completes
+    // The msg is retained until TX completes, so the caller may release its own reference right away
+    bool rfm_send_msg(SEEL_Msg_Handle handle, uint8_t seq_num, SEEL_Trans_Type type);
+
+    // Returns true while a transmission is in progress
+    // Completes finished transmissions and recovers from transmissions that never signal TxDone
+    bool rfm_tx_busy();
+
+    // Expected time until the transmission in progress is done, at least 1 so waiting tasks do not spin
+    uint32_t rfm_tx_remaining_millis();
+
+    // Returns true if the receive ISR has captured packets that have not been processed yet
+    bool rfm_msg_avail() {return !_rx_ring.empty();}
+
+    // Returns the oldest captured msg if it is valid and should be processed, otherwise NULL
+    // The msg stays in the receive ring and may be modified in place until rfm_receive_release() is called
+    // "receive_offset" is the time elapsed since the packet was received
+    SEEL_Message* rfm_receive_msg(int8_t& rssi, uint32_t& receive_offset);
 
-    bool rfm_receive_msg(SEEL_Message* rec_msg, int8_t& rssi, uint32_t& method_time);
+    // Releases the oldest captured msg back to the receive ISR
+    void rfm_receive_release() {_rx_ring.pop_front();}
+
+    // Returns true if the msg returned by rfm_receive_msg() carried SEEL_CMD_FLAG_SUBTREE_DONE
+    bool rfm_receive_subtree_done() {return _rx_ring.front()->subtree_done;}
+
+    // Takes the msg returned by rfm_receive_msg() out of the receive ring without copying it
+    // The ring slot gets a fresh pool msg instead. Returns SEEL_MSG_NO_HANDLE if the pool is exhausted
+    // The caller owns one reference to the returned handle
+    SEEL_Msg_Handle rfm_receive_adopt();
+
+    // Header filter used by the receive ISR when SEEL_RX_HEADER_FILTER_ENABLE is set
+    // Only the header fields (targ_id, send_id, cmd, seq_num) of "header" are valid
+    // Returns true if the rest of the msg should be read and passed to the receive task
+    // Runs in interrupt context
+    virtual bool rfm_header_accept(const SEEL_Message* header) = 0;
+
+    // Called by the send task before sending the front msg of the data queue
+    // Returns true if the msg should carry SEEL_CMD_FLAG_SUBTREE_DONE, see SEEL_EARLY_SLEEP_ENABLE
+    virtual bool subtree_done_hint() {return false;}
+
+    // Clears captured packets and puts the transceiver into continuous receive mode
+    void rfm_receive_start();
+
+    // Returns the transceiver to receive mode after TX, or to sleep if the receive gate is closed
+    // Safe to call from ISRs
+    void rfm_receive_resume();
+
+#if SEEL_CAD_ENABLE
+    // Starts a channel activity detection, _cad_done is set once it finishes and SEEL_SCHED_EVENT_CAD_DONE is raised
+    // On activity the transceiver is put into receive mode, otherwise to sleep
+    void rfm_cad_start();
+#endif // SEEL_CAD_ENABLE
+
+    // Returns the TDMA slot the received msg was sent in, "receive_offset" as returned by rfm_receive_msg()
+    uint8_t rfm_rx_slot(uint32_t receive_offset);
+
+#if SEEL_RX_GATE_ENABLE
+    // Returns true if msgs for this NODE may be sent in TDMA "slot"
+    bool rx_slot_needed(uint8_t slot);
+
+    // Opens (receive) or closes (sleep) the receive gate; an ongoing transmission applies it once done
+    void rfm_rx_gate_set(bool open);
+#endif // SEEL_RX_GATE_ENABLE
 
     void print_msg(SEEL_Message* msg);
 
     void enqueue_ack(SEEL_Message* prev_msg);
 
-    bool try_send(SEEL_Message* to_send_ptr, bool seq_inc);
+    // Adds the send task, it runs until the scheduler is cleared and parks itself while there is nothing to send
+    void send_start();
+
+    // Call after queueing something to send (or allowing it to be sent), wakes the send task if it is parked
+    void send_ready();
+
+    // True if the send task has a bcast, ACK or data msg it could send
+    bool send_pending();
+
+    bool try_send(SEEL_Msg_Handle handle, bool seq_inc, SEEL_Trans_Type type);
 
     void set_flag(SEEL_Flags flag);
 
@@ -153,32 +281,51 @@ protected:
     LoRaClass* _LoRaPHY_ptr; // Transceiver library pointer
     user_callback_presend_t _user_cb_presend;
 
+    SEEL_Ring<SEEL_Rx_Packet, SEEL_RX_RING_SIZE> _rx_ring; // Filled by rfm_receive_isr()
     SEEL_Default_Queue<uint8_t> _ack_queue;
-    SEEL_Queue<SEEL_Message>* _data_queue_ptr; // includes ID_CHECK and FWD msgs
+    SEEL_Data_Queue* _data_queue_ptr; // includes ID_CHECK and FWD msgs
     SEEL_Transmissions _cycle_transmissions;
-    SEEL_Message _bcast_msg;
+    SEEL_Msg_Pool* _msg_pool_ptr;
+    SEEL_Msg_Handle _bcast_handle; // Bcast msg to forward, valid while _bcast_avail
+    SEEL_Msg_Handle _tx_handle; // Msg being transmitted, retained until TX completes
     SEEL_CB_Info _cb_info;
 
-    uint32_t _last_msg_sent_time; // Exponential Backoff (EB), how long ago last msg was sent
-    uint32_t _msg_send_delay; // EB, how long to delay until next transmission attempt
-    uint32_t _unack_msgs; // EB, number of unacked msgs so far, reset to 0 on msg ack
+    SEEL_MAC _mac; // Collision avoidance
+    uint32_t _unack_msgs; // Number of unacked msgs so far, reset to 0 on msg ack
     uint32_t _tranmission_ToA; // estimate on ToA based on last measured transmission. Should be consistent since transmission parameters are consistent
+    uint32_t _tx_start_time;
+    SEEL_Scheduler::SEEL_Task_Handle _send_handle; // Set by send_start()
+    bool _send_parked; // Send task is waiting for send_ready()
+    volatile uint32_t _tx_done_time; // Set by rfm_tx_done_isr()
     uint8_t _node_id;
     uint8_t _parent_id;
     uint8_t _tdma_slot; // TDMA transmission slot
-    uint8_t _prev_tdma_slot;
     uint8_t _seq_num; // Note: Will overflow after 255, but overflow does not affect functionality since seq_num serves to differentiate msgs
     uint8_t _CRC_fails;
     uint8_t _max_data_queue_size;
     uint8_t _queue_dropped_msgs_self;
     uint8_t _queue_dropped_msgs_others;
     uint8_t _failed_transmissions;
+    volatile uint8_t _rx_overflows; // Packets dropped by rfm_receive_isr() because _rx_ring was full
+#if SEEL_CAD_ENABLE
+    volatile bool _cad_done; // Set by rfm_cad_done_isr()
+    volatile bool _cad_detected; // Result of the last CAD, valid once _cad_done is set
+#endif // SEEL_CAD_ENABLE
+#if SEEL_RX_GATE_ENABLE
+    uint32_t _rx_slot_mask; // TDMA slots children sent in this cycle, bit N is slot N
+    uint32_t _rx_slot_mask_prev; // _rx_slot_mask of the previous cycle
+    uint8_t _rx_parent_slot; // TDMA slot of the parent's ACKs, SEEL_TDMA_SLOTS if unknown
+    volatile bool _rx_gate_open; // Read by rfm_receive_resume(), set to true by rfm_receive_start()
+#endif // SEEL_RX_GATE_ENABLE
     uint8_t _flags;
     int8_t _path_rssi; // changes based on parent selection mode
     bool _id_verified;
     bool _bcast_avail; // bcast msg is ready to be sent out
     bool _bcast_sent; // bcast msg has been sent out this cycle
     bool _parent_lock;
+    bool _tx_busy; // Transmission started and not yet completed
+    volatile bool _tx_done; // Set by rfm_tx_done_isr()
+    SEEL_Trans_Type _tx_type;
     
 private:
     // Structs & Classes
@@ -198,10 +345,31 @@ private:
     // Returns true if msg is a duplicate msg (should be ignored)
     bool dup_msg_check(SEEL_Message* msg);
 
+    // Moves flag bits out of the received msg's cmd into "packet", so cmd compares equal to a SEEL_CMD_*
+    static void rfm_strip_cmd_flags(SEEL_Rx_Packet* packet, SEEL_Message* msg);
+
+    // Transceiver RxDone callback, runs in interrupt context
+    // Copies the packet out of the transceiver FIFO into _rx_ring and raises SEEL_SCHED_EVENT_RX
+    static void rfm_receive_isr(int packet_size);
+
+#if SEEL_CAD_ENABLE
+    // Transceiver CadDone callback, runs in interrupt context
+    static void rfm_cad_done_isr(bool detected);
+#endif // SEEL_CAD_ENABLE
+
+    // Transceiver TxDone callback, runs in interrupt context
+    // Returns the transceiver to receive mode and raises SEEL_SCHED_EVENT_TX_DONE
+    static void rfm_tx_done_isr();
+
+    // Records ToA, increments transmission counters and logs the sent msg
+    void rfm_tx_complete();
+
     // ***************************************************
     // Member variables
     SEEL_Dup_Msg _dup_msgs[SEEL_DUP_MSG_SIZE];
     uint8_t _oldest_dup_index = 0;
+
+    static SEEL_Node* _isr_inst; // Node served by rfm_receive_isr(), only one transceiver is supported
 };
 
 #endif // SEEL_Node_h
\ No newline at end of file
@@ -12,6 +12,8 @@ File purpose:   Contains adjustable parameters (along with recommended defaults)
 
 #include <LowPower.h> // To access LowPower.h constexprants
 
+#include "SEEL_Airtime.h"
+
 /*
     Note: Any changes to the width of these constexprants will require similar changes to 
     their assigned and compared against variables in the rest of the code.
@@ -36,12 +38,87 @@ constexpr uint8_t SEEL_ASSERT_NVM_CELLS_PER_ENTRY = 4; // Number of NVM cells fo
 constexpr uint16_t SEEL_ASSERT_NVM_MAX_FILE_NUM = 32767; // 15 bits for file
 constexpr uint16_t SEEL_ASSERT_NVM_MAX_LINE_NUM = 65535; // 16 bits for line
 
+// Compile-time log filtering. SEEL_Print statements are wrapped in "if (SEEL_Print::enabled(category, level))";
+// statements above SEEL_LOG_MAX_LEVEL, or whose category is not in SEEL_LOG_CATEGORIES, generate no code or flash strings
+// Runtime control (SEEL_Print::init() with a NULL stream) only mutes output that is compiled in
+enum SEEL_LOG_LEVEL
+{
+    SEEL_LOG_LEVEL_NONE,
+    SEEL_LOG_LEVEL_ERROR, // Failures and dropped msgs
+    SEEL_LOG_LEVEL_INFO, // Sent and received msgs, parent and sleep changes; the logs SEEL_log_parser.py reads
+    SEEL_LOG_LEVEL_DEBUG // Queue contents and timing adjustments
+};
+enum SEEL_LOG_CATEGORY
+{
+    SEEL_LOG_RADIO = 0x01, // Transceiver setup, sends and receives
+    SEEL_LOG_QUEUE = 0x02, // Msg, ACK and bcast queues
+    SEEL_LOG_SCHED = 0x04, // Scheduler and tasks
+    SEEL_LOG_ROUTING = 0x08, // IDs, parents and blacklists
+    SEEL_LOG_SLEEP = 0x10, // Wake, sleep and cycle timing
+    SEEL_LOG_ALL = 0x1F
+};
+constexpr SEEL_LOG_LEVEL SEEL_LOG_MAX_LEVEL = SEEL_LOG_LEVEL_DEBUG;
+constexpr uint8_t SEEL_LOG_CATEGORIES = SEEL_LOG_ALL; // OR of SEEL_LOG_CATEGORY values
+
+// If enabled, SEEL_Print output is buffered in a RAM ring and written to the stream only while the scheduler idles
+// and before SNODE sleep, so logging does not block time-critical code. Sent and received msgs are logged as compact
+// binary records instead of text; convert captured logs with misc/SEEL_log_decoder.py before running SEEL_log_parser.py
+// Output that does not fit in the ring is dropped and reported by the decoder
+#define SEEL_LOG_DEFERRED_ENABLE FALSE
+constexpr uint16_t SEEL_LOG_RING_SIZE = 256; // Bytes, power of two; fits a bcast plus several full send/receive records
+// Bytes written per idle pass to streams whose availableForWrite() always returns 0 (no TX buffer info)
+// Leave at 0 for HardwareSerial, which reports its free TX buffer space
+constexpr uint8_t SEEL_LOG_DRAIN_CHUNK = 0;
+
 // ***************************************************
 /* SEEL Queue */
 
 constexpr uint8_t SEEL_DEFAULT_QUEUE_SIZE = 10; // Allocation size of ALL queues used in SEEL
 constexpr uint8_t SEEL_SNODE_MSG_QUEUE_SIZE = 7; // Optimize for message size in buffers
 constexpr uint8_t SEEL_SCHED_QUEUE_SIZE = 10; // Must maintain minimum size (7) for scheduler to function
+constexpr uint8_t SEEL_RX_RING_SIZE = 4; // Packets buffered between the receive ISR and receive task, must be a power of two
+
+// Msg pool sizes, all msg buffers of a NODE are taken from its pool
+// GNODE: receive ring, plus the bcast or ACK msg being sent
+// SNODE: receive ring and data queue, plus the bcast to forward and the ACK msg being sent
+constexpr uint8_t SEEL_GNODE_MSG_POOL_SIZE = SEEL_RX_RING_SIZE + 1;
+constexpr uint8_t SEEL_SNODE_MSG_POOL_SIZE = SEEL_RX_RING_SIZE + SEEL_SNODE_MSG_QUEUE_SIZE + 2;
+
+// SNODE data queue overflow policy, applied when a msg arrives while all SEEL_SNODE_MSG_QUEUE_SIZE slots are in use
+// The msg currently being sent (awaiting ACK) and ID_CHECK msgs are never evicted
+enum SEEL_QUEUE_DROP_POLICY
+{
+    SEEL_QDROP_NEWEST, // Drops the arriving msg
+    SEEL_QDROP_OLDEST_OWN, // Evicts this NODE's oldest DATA msg, otherwise drops the arriving msg
+    SEEL_QDROP_STALEST // Evicts the DATA msg that has been queued the longest, otherwise drops the arriving msg
+};
+constexpr SEEL_QUEUE_DROP_POLICY SEEL_QDROP_POLICY = SEEL_QDROP_NEWEST;
+// If enabled, a forwarded msg arriving at a full queue first evicts the newest forwarded msg of the child
+// holding the most slots, so one busy child cannot take the queue from the rest of the subtree
+constexpr bool SEEL_QUEUE_FWD_FAIR_ENABLE = true;
+
+// If enabled, the receive ISR reads the msg header first and drops msgs not meant for this NODE (and non-SEEL packets)
+// without reading the payload. Dropped msgs are not logged
+constexpr bool SEEL_RX_HEADER_FILTER_ENABLE = true;
+
+// ***************************************************
+/* SEEL Scheduler */
+
+// If enabled, the scheduler puts the MCU into idle sleep while no task is due
+// Idle sleep keeps timers and peripherals running; any interrupt (millis() tick, radio, serial) wakes the MCU
+#define SEEL_SCHED_IDLE_ENABLE TRUE
+
+// If enabled, the scheduler records per-task lateness and run time, loop rate and idle fraction
+// Adds a micros() read around every task and idle wait; see SEEL_Scheduler::get_task_stats()
+#define SEEL_SCHED_STATS_ENABLE FALSE
+constexpr uint8_t SEEL_SCHED_STATS_SIZE = 8; // Number of distinct tasks tracked, later tasks are not recorded
+
+// Default run time budget of user tasks, see SEEL_Task::set_budget_millis()
+// A due user task is deferred if it would still be running when the next critical SEEL task (TDMA send, bcast, sleep) is due
+constexpr uint16_t SEEL_SCHED_USER_BUDGET_MILLIS = 50;
+// A due user task that has waited this long runs ahead of due system tasks (not critical ones), so busy system tasks
+// cannot starve user tasks
+constexpr uint32_t SEEL_SCHED_USER_MAX_WAIT_MILLIS = 100;
 
 // ***************************************************
 /* SEEL LoRa Params */
@@ -53,14 +130,19 @@ constexpr int8_t SEEL_RFM95_GNODE_TX = 2; // 2 to 20 for PA Boost
 constexpr int8_t SEEL_RFM95_GNODE_CR = 5; // 5 to 8
 constexpr int8_t SEEL_RFM95_SNODE_TX = 2; // 2 to 20 for PA Boost
 constexpr int8_t SEEL_RFM95_SNODE_CR = 5; // 5 to 8
+constexpr uint16_t SEEL_RFM95_PREAMBLE_LEN = 8; // Symbols, LoRa library default
+constexpr bool SEEL_RFM95_CRC_ENABLE = true; // Payload CRC, enabled in SEEL_Node::rfm_init()
+constexpr bool SEEL_RFM95_IMPLICIT_HEADER = false; // Explicit header mode, required for SF 7 to 12
 
 // SEEL Message size
 // Additional bytes allocated for the message packet
 // In addition to the default SEEL_MSG_MISC_SIZE in SEEL_Defines.h
-// Influences the ToA of a message, which may require changing TDMA parameters (if using TDMA)
+// Influences the ToA of a message, TDMA slot widths are derived from it (see SEEL_TRANSMISSION_TOA_MILLIS)
 // More allocated bytes lets users send more data at a time, allows more SNODEs to join the network per cycle,
 // and increases the number of NODEs that can be ACK'd per ACK message
 constexpr uint32_t SEEL_MSG_USER_SIZE = 4;
+// Bytes sent per msg over the air, must equal SEEL_MSG_TOTAL_SIZE in SEEL_Defines.h (header + SEEL_MSG_MISC_SIZE + user size)
+constexpr uint8_t SEEL_MSG_AIRTIME_SIZE = 23 + SEEL_MSG_USER_SIZE;
 
 // Duplicate msg holder
 // How many messages to hold when checking for duplicates
@@ -82,10 +164,41 @@ constexpr uint8_t SEEL_MAX_CYCLE_MISSES = 25;
 // ***************************************************
 /* SEEL_SNode */
 
-// Upperbound transmission duration used to create TDMA slot widths. Also used as initial estimate 
-// to correct for transmission delay when time sychronizing; value will be updated with measured msg send ToA
+// Time on air of a SEEL msg, computed from the LoRa params above with the slower of the GNODE and SNODE coding rates
+// Used as initial estimate to correct for transmission delay when time sychronizing; value will be updated with measured msg send ToA
 // SEEL_Print'ed in RFM send method
-constexpr uint32_t SEEL_TRANSMISSION_UB_DUR_MILLIS = 100;
+constexpr uint32_t SEEL_TRANSMISSION_TOA_MILLIS = seel_airtime_millis(SEEL_MSG_AIRTIME_SIZE, SEEL_RFM95_SF, SEEL_RFM95_BW,
+    (SEEL_RFM95_GNODE_CR > SEEL_RFM95_SNODE_CR) ? SEEL_RFM95_GNODE_CR : SEEL_RFM95_SNODE_CR,
+    SEEL_RFM95_PREAMBLE_LEN, SEEL_RFM95_CRC_ENABLE, SEEL_RFM95_IMPLICIT_HEADER);
+
+// If enabled, SNODEs wait for the bcast by running a channel activity detection (CAD) every SEEL_CAD_PERIOD_MILLIS and sleeping
+// the transceiver in between, instead of staying in continuous receive. On activity the transceiver receives until the msg is in
+// Bcasts are sent with a preamble that spans a CAD period, so a CAD always falls into it. Receivers program the long preamble,
+// as required for varying preamble lengths (SX1276 datasheet 4.1.1.6). The longer bcast widens TDMA slots
+// After SEEL_CAD_FALSE_DETECT_LIMIT detections in a cycle that were not the bcast, the SNODE falls back to continuous receive for the
+// cycle; after SEEL_CAD_MISSED_BCAST_LIMIT missed bcasts in a row, it waits in continuous receive until a bcast is received
+// All NODEs, GNODE included, must use the same setting
+#define SEEL_CAD_ENABLE FALSE
+constexpr uint32_t SEEL_CAD_PERIOD_MILLIS = 50; // Transceiver sleep between CADs
+constexpr uint32_t SEEL_CAD_LATENCY_MILLIS = 10; // Scheduler and ISR delay on top of the CAD period, also covered by the preamble
+constexpr uint8_t SEEL_CAD_FALSE_DETECT_LIMIT = 5;
+constexpr uint8_t SEEL_CAD_MISSED_BCAST_LIMIT = 2;
+constexpr uint32_t SEEL_CAD_BCAST_PREAMBLE_LEN = seel_airtime_preamble_covering(SEEL_CAD_PERIOD_MILLIS + SEEL_CAD_LATENCY_MILLIS,
+    SEEL_RFM95_SF, SEEL_RFM95_BW, SEEL_RFM95_PREAMBLE_LEN);
+constexpr uint32_t SEEL_CAD_BCAST_TOA_MILLIS = seel_airtime_millis(SEEL_MSG_AIRTIME_SIZE, SEEL_RFM95_SF, SEEL_RFM95_BW,
+    (SEEL_RFM95_GNODE_CR > SEEL_RFM95_SNODE_CR) ? SEEL_RFM95_GNODE_CR : SEEL_RFM95_SNODE_CR,
+    SEEL_CAD_BCAST_PREAMBLE_LEN, SEEL_RFM95_CRC_ENABLE, SEEL_RFM95_IMPLICIT_HEADER);
+// Extra ToA of bcasts over other msgs, accounted for when time synchronizing
+constexpr uint32_t SEEL_BCAST_EXTRA_TOA_MILLIS = SEEL_CAD_ENABLE ? SEEL_CAD_BCAST_TOA_MILLIS - SEEL_TRANSMISSION_TOA_MILLIS : 0;
+
+// Time between starting a send and the transmission beginning (FIFO load over SPI) and the TxDone interrupt being serviced
+constexpr uint32_t SEEL_TRANSMISSION_MARGIN_MILLIS = 5;
+// Upperbound transmission duration used to create TDMA slot widths, must be at least SEEL_TRANSMISSION_TOA_MILLIS
+constexpr uint32_t SEEL_TRANSMISSION_UB_DUR_MILLIS = SEEL_TRANSMISSION_TOA_MILLIS + SEEL_BCAST_EXTRA_TOA_MILLIS + SEEL_TRANSMISSION_MARGIN_MILLIS;
+// How long the transceiver keeps receiving after a CAD detected activity, enough for a whole bcast
+constexpr uint32_t SEEL_CAD_RX_HOLD_MILLIS = SEEL_CAD_BCAST_TOA_MILLIS + SEEL_TRANSMISSION_MARGIN_MILLIS;
+// Transmissions that have not signalled TxDone after this long are aborted; must be longer than the ToA
+constexpr uint32_t SEEL_TRANSMISSION_TIMEOUT_MILLIS = 10 * SEEL_TRANSMISSION_UB_DUR_MILLIS;
 
 // How long Arduino watchdog timer can sleep at a time
 // Only select values can be used, check Arduino WD specs (SLEEP_8S is maximum duration per sleep instance)
@@ -115,20 +228,44 @@ constexpr float SEEL_FORCE_SLEEP_AWAKE_DURATION_SCALE = 1.5f;
 // Set this value to 0 to disable force sleep (always stay on waiting for bcast)
 constexpr uint32_t SEEL_FORCE_SLEEP_RESET_COUNT = 3;
 
+// If enabled, SNODEs go to sleep before their awake time ends once their subtree has nothing left to send:
+// the user load callback was polled, the data and ACK queues are empty, and every known child (learned from forwarded msgs)
+// either flagged its subtree done or stayed silent for SEEL_EARLY_SLEEP_SILENT_CYCLES TDMA cycles
+// The SNODE stays awake at least SEEL_EARLY_SLEEP_SILENT_CYCLES TDMA cycles after forwarding the bcast so new children can join
+// SNODEs flag their last msg of the cycle (SEEL_CMD_FLAG_SUBTREE_DONE) so parents do not have to wait out the silence
+// The skipped awake time is added to the sleep, the wake-up time is unchanged. Msgs loaded after an early sleep wait for the next cycle
+#define SEEL_EARLY_SLEEP_ENABLE FALSE
+constexpr uint32_t SEEL_EARLY_SLEEP_SILENT_CYCLES = 3; // At least 2, a done child gets one TDMA cycle to resend a msg whose ACK was lost
+constexpr uint8_t SEEL_EARLY_SLEEP_MAX_CHILDREN = 8; // Children tracked; while more children are active, early sleep is skipped
+constexpr uint8_t SEEL_EARLY_SLEEP_CHILD_EXPIRE_CYCLES = 3; // Children not heard from in this many cycles in a row are forgotten
+
 // Collision avoidance scheme 1: TDMA
 // Time for all slots to send = transmission_duration * slots + buffer * (slots - 1)
 // Pros: Shorter wait window, more predictable performance
 // Cons: Requires user setup and calculation unique to each deployment
+// Slot width follows the computed ToA (SEEL_TRANSMISSION_UB_DUR_MILLIS); changes to the LoRa params or msg size resize slots at compile time
 // [*SEEL_TDMA_PRE_BUFFER_MILLIS*|******SEEL_TRANSMISSION_UB_DUR_MILLIS******|*SEEL_TDMA_POST_BUFFER_MILLIS*]
 // Prebuffer determines how many repeat messages can fit in a slot
 // Postbuffer allows widening the TDMA slot for misc processing delays
-constexpr bool SEEL_TDMA_USE_TDMA = true; // Otherwise uses Exponential backoff
+constexpr bool SEEL_TDMA_USE_TDMA = true; // Otherwise uses Exponential backoff. Selects SEEL_MAC, see SEEL_Policies.h
 constexpr bool SEEL_TDMA_SINGLE_SEND = true; // Only sends 1 message per TDMA slot, otherwise sends as many as possible
 constexpr uint8_t SEEL_TDMA_SLOTS = 10; // Maximum group of nodes, first slot begins at 0
 constexpr uint32_t SEEL_TDMA_BUFFER_MILLIS = 400; // Buffer time between scheduled TMDA transmissions, factors in receive buffer copy delay (SEEL_Print'ed in RFM receive method)
 constexpr uint32_t SEEL_TDMA_SLOT_WAIT_MILLIS = SEEL_TRANSMISSION_UB_DUR_MILLIS + SEEL_TDMA_BUFFER_MILLIS;
 constexpr uint32_t SEEL_TDMA_CYCLE_TIME_MILLIS = SEEL_TDMA_SLOT_WAIT_MILLIS * SEEL_TDMA_SLOTS;
 
+// If enabled (TDMA only), SNODEs keep the transceiver in receive mode only during the TDMA slots of their children
+// (learned from forwarded msgs, this and the previous cycle) and of their parent while waiting for an ACK, and sleep it otherwise
+// Receive stays continuous until the bcast is forwarded and for SEEL_RX_GATE_LEARN_CYCLES TDMA cycles after, so children can join;
+// children that first send in a new slot after that are heard from the next cycle on. An unknown parent slot keeps receive on
+#define SEEL_RX_GATE_ENABLE FALSE
+constexpr uint32_t SEEL_RX_GATE_LEARN_CYCLES = 2;
+constexpr uint32_t SEEL_RX_GATE_GUARD_MILLIS = 50; // Receive window widening on both sides of a slot, covers time sync error
+
+// How often SNODEs call the user load callback (user_callback_load_t) during the data phase
+// Loaded msgs are only sent in the NODE's TDMA slot, so polling once per slot does not delay them
+constexpr uint32_t SEEL_SNODE_USER_POLL_MILLIS = SEEL_TDMA_SLOT_WAIT_MILLIS;
+
 // Collision avoidance scheme 2: Exponential backoff 
 // Pros: Less user parameter tuning
 // Cons: Longer wait window
@@ -146,7 +283,7 @@ enum SEEL_PARENT_SELECTION_MODE
     SEEL_PSEL_PATH_RSSI // Selects parent with the best path RSSI, where path RSSI is determined by the worst RSSI along the path
 };
 // If enabled, collects broadcasts for a duration of SEEL_SMART_PARENT_DURATION_MILLIS after receiving a bcast and update parent if better
-constexpr SEEL_PARENT_SELECTION_MODE SEEL_PSEL_MODE = SEEL_PSEL_PATH_RSSI;
+constexpr SEEL_PARENT_SELECTION_MODE SEEL_PSEL_MODE = SEEL_PSEL_PATH_RSSI; // Selects SEEL_PSel, see SEEL_Policies.h
 constexpr uint32_t SEEL_PSEL_DURATION_MILLIS = SEEL_TDMA_CYCLE_TIME_MILLIS;
 
 #endif // SEEL_Params
\ No newline at end of file
@@ -0,0 +1,43 @@
+/*
+The SEEL repository can be found at: https://github.com/SEEL-Group/SEEL
+Copyright (C) SEEL Group 2021 all rights reserved
+See license file in root folder for more licensing details
+See SEEL_documentation.pdf for protocol description details
+
+File purpose:   See SEEL_Policies.h
+*/
+
+#include "SEEL_Policies.h"
+
+bool SEEL_MAC_TDMA::can_send(SEEL_Scheduler* ref_scheduler, uint8_t tdma_slot)
+{
+    // TDMA slots are aligned to network time
+    uint32_t cycle_millis = ref_scheduler->get_network_millis() % SEEL_TDMA_CYCLE_TIME_MILLIS;
+    uint32_t slot_start_millis = tdma_slot * SEEL_TDMA_SLOT_WAIT_MILLIS;
+
+    // NODE should not start a msg after the buffer since the msg is expected to finish after the slot
+    if (cycle_millis < slot_start_millis)
+    {
+        ref_scheduler->rearm_current_task(slot_start_millis - cycle_millis);
+        return false;
+    }
+    if (cycle_millis >= slot_start_millis + SEEL_TDMA_BUFFER_MILLIS)
+    {
+        ref_scheduler->rearm_current_task(SEEL_TDMA_CYCLE_TIME_MILLIS - cycle_millis + slot_start_millis);
+        return false;
+    }
+    if (SEEL_TDMA_SINGLE_SEND)
+    {
+        // Only send on the first run in the slot, next run is in the next cycle's slot
+        ref_scheduler->rearm_current_task(SEEL_TDMA_CYCLE_TIME_MILLIS - cycle_millis + slot_start_millis);
+    }
+    return true;
+}
+
+void SEEL_MAC_EB::on_sent(uint32_t unack_msgs)
+{
+    _last_msg_sent_time = millis();
+    // Backoff window grows by SEEL_EB_EXP_SCALE per unACK'd msg, capped at the largest value random() accepts
+    uint64_t window = SEEL_Fixed::scale(SEEL_EB_INIT_MILLIS, SEEL_Fixed::pow(SEEL_EB_EXP_SCALE_Q16, unack_msgs));
+    _msg_send_delay = random(SEEL_EB_MIN_MILLIS, (window > INT32_MAX) ? INT32_MAX : (int32_t) window);
+}
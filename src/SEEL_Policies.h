@@ -0,0 +1,128 @@
+/*
+The SEEL repository can be found at: https://github.com/SEEL-Group/SEEL
+Copyright (C) SEEL Group 2021 all rights reserved
+See license file in root folder for more licensing details
+See SEEL_documentation.pdf for protocol description details
+
+File purpose:   Collision avoidance and parent selection policies, selected at compile time in SEEL_Params.h
+*/
+
+#ifndef SEEL_Policies_h
+#define SEEL_Policies_h
+
+#include "SEEL_Defines.h"
+#include "SEEL_Scheduler.h"
+
+/*
+Collision avoidance (MAC) policies, used by the NODE send task
+Each policy holds only the state it needs, the unselected policy is never instantiated
+    TIME_SLOTTED: true if sends are bound to the NODE's TDMA slot
+    reset(): called on wake-up
+    can_send(): called by the send task when it could send, returns if a msg may be sent now
+                May re-arm the calling (send) task to the next time a msg may be sent
+    on_sent(): called once a msg started sending, "unack_msgs" is the number of msgs sent without an ACK
+    on_ack(): called when this NODE's msgs are ACK'd
+    wake_guard_millis(): how much earlier than the expected bcast an SNODE wakes up when "shift_hops" hops above it may
+                         forward the bcast earlier than last cycle, on top of SEEL_ADJUSTED_SLEEP_EARLY_WAKE_MILLIS (drift guard)
+*/
+
+// Collision avoidance scheme 1: TDMA, see SEEL_TDMA_* in SEEL_Params.h
+class SEEL_MAC_TDMA
+{
+public:
+    static const bool TIME_SLOTTED = true;
+
+    void reset() {}
+    bool can_send(SEEL_Scheduler* ref_scheduler, uint8_t tdma_slot);
+    void on_sent(uint32_t unack_msgs) {}
+    void on_ack() {}
+
+    static uint32_t wake_guard_millis(uint8_t shift_hops)
+    {
+        // Hops forward the bcast in their TDMA slot, so a hop forwarding early moves the bcast up by an entire TDMA cycle
+        return SEEL_TDMA_CYCLE_TIME_MILLIS * shift_hops;
+    }
+};
+
+// Collision avoidance scheme 2: Exponential backoff, see SEEL_EB_* in SEEL_Params.h
+class SEEL_MAC_EB
+{
+public:
+    static const bool TIME_SLOTTED = false;
+
+    SEEL_MAC_EB() : _last_msg_sent_time(0), _msg_send_delay(0) {}
+
+    // The first msg after wake-up may be sent right away
+    void reset() {_last_msg_sent_time = millis() - 1; _msg_send_delay = 0;}
+    bool can_send(SEEL_Scheduler* ref_scheduler, uint8_t tdma_slot)
+    {
+        uint32_t elapsed_millis = millis() - _last_msg_sent_time;
+        if (elapsed_millis > _msg_send_delay)
+        {
+            return true;
+        }
+        ref_scheduler->rearm_current_task(_msg_send_delay - elapsed_millis + 1);
+        return false;
+    }
+    void on_sent(uint32_t unack_msgs);
+    void on_ack() {_msg_send_delay = 0;}
+
+    static uint32_t wake_guard_millis(uint8_t shift_hops) {return 0;}
+
+private:
+    uint32_t _last_msg_sent_time; // When the last msg was sent
+    uint32_t _msg_send_delay; // How long to delay until next transmission attempt
+};
+
+/*
+Parent selection policies, used by SNODEs on bcast reception
+    COLLECT: if true, bcasts are collected for SEEL_PSEL_DURATION_MILLIS after the first one and the parent
+             may be replaced by a better sender; otherwise the sender of the first bcast is kept
+    metric(): heuristic of a bcast sender from the received "rssi" and the sender's "path_rssi"
+    better(): if a sender with "metric" and "hop_count" should replace the current parent
+*/
+
+// Selects parent based off of sender of first received broadcast message
+struct SEEL_PSel_First_Bcast
+{
+    static const bool COLLECT = false;
+    static int8_t metric(int8_t rssi, int8_t path_rssi) {return rssi;}
+    static bool better(int8_t metric, uint32_t hop_count, int8_t parent_metric, uint8_t parent_hop_count) {return false;}
+};
+
+// Selects parent based off of the immediate sender with the largest RSSI among received broadcast messages
+struct SEEL_PSel_Immediate_RSSI
+{
+    static const bool COLLECT = true;
+    static int8_t metric(int8_t rssi, int8_t path_rssi) {return rssi;}
+    static bool better(int8_t metric, uint32_t hop_count, int8_t parent_metric, uint8_t parent_hop_count)
+    {
+        // Hop count check prevents cycles from forming
+        return hop_count >= parent_hop_count && metric > parent_metric;
+    }
+};
+
+// Selects parent with the best path RSSI, where path RSSI is determined by the worst RSSI along the path
+struct SEEL_PSel_Path_RSSI
+{
+    static const bool COLLECT = true;
+    static int8_t metric(int8_t rssi, int8_t path_rssi) {return min(rssi, path_rssi);}
+    static bool better(int8_t metric, uint32_t hop_count, int8_t parent_metric, uint8_t parent_hop_count)
+    {
+        return SEEL_PSel_Immediate_RSSI::better(metric, hop_count, parent_metric, parent_hop_count);
+    }
+};
+
+// Maps SEEL_PARENT_SELECTION_MODE to its policy
+template <SEEL_PARENT_SELECTION_MODE mode>
+struct SEEL_PSel_Select {typedef SEEL_PSel_Path_RSSI type;};
+template <>
+struct SEEL_PSel_Select<SEEL_PSEL_FIRST_BROADCAST> {typedef SEEL_PSel_First_Bcast type;};
+template <>
+struct SEEL_PSel_Select<SEEL_PSEL_IMMEDIATE_RSSI> {typedef SEEL_PSel_Immediate_RSSI type;};
+
+// Policies used by this build
+typedef SEEL_Type_Select<SEEL_TDMA_USE_TDMA, SEEL_MAC_TDMA, SEEL_MAC_EB>::type SEEL_MAC;
+typedef SEEL_PSel_Select<SEEL_PSEL_MODE>::type SEEL_PSel;
+
+#endif // SEEL_Policies_h
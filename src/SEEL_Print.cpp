@@ -9,4 +9,207 @@ File purpose:   See SEEL_Print.h
 
 #include "SEEL_Print.h"
 
-Stream* SEEL_Print::_print_stream = NULL;
\ No newline at end of file
+Stream* SEEL_Print::_print_stream = NULL;
+
+SEEL_Print_Line::SEEL_Print_Line(char* buf, uint8_t capacity)
+    : _buf(buf), _capacity(capacity)
+{
+    clear();
+}
+
+void SEEL_Print_Line::clear()
+{
+    _len = 0;
+    _truncated = false;
+    _buf[0] = '\0';
+}
+
+SEEL_Print_Line& SEEL_Print_Line::add(char c)
+{
+    if (_len + 1 >= _capacity)
+    {
+        _truncated = true;
+        return *this;
+    }
+    _buf[_len++] = c;
+    _buf[_len] = '\0';
+    return *this;
+}
+
+SEEL_Print_Line& SEEL_Print_Line::add(const char* s)
+{
+    while (*s != '\0' && !_truncated)
+    {
+        add(*s++);
+    }
+    return *this;
+}
+
+SEEL_Print_Line& SEEL_Print_Line::add(const __FlashStringHelper* s)
+{
+    PGM_P p = reinterpret_cast<PGM_P>(s);
+    char c;
+    while ((c = pgm_read_byte(p++)) != '\0' && !_truncated)
+    {
+        add(c);
+    }
+    return *this;
+}
+
+SEEL_Print_Line& SEEL_Print_Line::add_dec(uint32_t v)
+{
+    char digits[10]; // UINT32_MAX has 10 digits
+    uint8_t n = 0;
+    do
+    {
+        digits[n++] = '0' + v % 10;
+        v /= 10;
+    } while (v > 0);
+
+    while (n > 0)
+    {
+        add(digits[--n]);
+    }
+    return *this;
+}
+
+SEEL_Print_Line& SEEL_Print_Line::add_dec_signed(int32_t v)
+{
+    if (v < 0)
+    {
+        add('-');
+        return add_dec(-(uint32_t) v); // Unsigned negation so INT32_MIN does not overflow
+    }
+    return add_dec((uint32_t) v);
+}
+
+SEEL_Print_Line& SEEL_Print_Line::add_hex(uint32_t v, uint8_t min_digits)
+{
+    char digits[8];
+    uint8_t n = 0;
+    do
+    {
+        uint8_t nibble = v & 0xF;
+        digits[n++] = (nibble < 10) ? ('0' + nibble) : ('A' + nibble - 10);
+        v >>= 4;
+    } while (v > 0);
+
+    for (uint8_t pad = n; pad < min_digits; ++pad)
+    {
+        add('0');
+    }
+    while (n > 0)
+    {
+        add(digits[--n]);
+    }
+    return *this;
+}
+
+SEEL_Print_Line& SEEL_Print_Line::add_bytes(const uint8_t* bytes, uint8_t len, char sep)
+{
+    for (uint8_t i = 0; i < len && !_truncated; ++i)
+    {
+        add_dec(bytes[i]);
+        add(sep);
+    }
+    return *this;
+}
+
+#if SEEL_LOG_DEFERRED_ENABLE
+SEEL_Print_Ring SEEL_Print::_ring;
+
+size_t SEEL_Print_Ring::write(uint8_t b)
+{
+    uint8_t* slot = _ring.push_slot();
+    if (slot == NULL)
+    {
+        ++_dropped;
+        return 0;
+    }
+    *slot = b;
+    _ring.push_commit();
+    return 1;
+}
+
+bool SEEL_Print_Ring::write_record(const uint8_t* rec, uint8_t len)
+{
+    if (_ring.max_size() - _ring.size() < len + 1)
+    {
+        _dropped += len + 1;
+        return false;
+    }
+    write(SEEL_LOG_RECORD_MARK);
+    for (uint8_t i = 0; i < len; ++i)
+    {
+        write(rec[i]);
+    }
+    return true;
+}
+
+uint16_t SEEL_Print_Ring::drain(Print* out, uint16_t budget)
+{
+    uint16_t moved = 0;
+    while (moved < budget && !_ring.empty())
+    {
+        out->write(*_ring.front());
+        _ring.pop_front();
+        ++moved;
+    }
+    return moved;
+}
+
+bool SEEL_Print::record(const uint8_t* rec, uint8_t len)
+{
+    return _print_stream != NULL && _ring.write_record(rec, len);
+}
+
+void SEEL_Print::drain(bool all)
+{
+    if (_print_stream == NULL)
+    {
+        return;
+    }
+
+    int budget = _print_stream->availableForWrite();
+    if (all)
+    {
+        budget = SEEL_LOG_RING_SIZE;
+    }
+    else if (budget <= 0)
+    {
+        budget = SEEL_LOG_DRAIN_CHUNK;
+    }
+    _ring.drain(_print_stream, budget);
+
+    // Report dropped output once everything before the drop is out
+    if (_ring.empty() && (all || _print_stream->availableForWrite() >= 4))
+    {
+        uint16_t dropped = _ring.take_dropped();
+        if (dropped > 0)
+        {
+            _print_stream->write(SEEL_LOG_RECORD_MARK);
+            _print_stream->write(SEEL_LOG_EVENT_DROPPED);
+            _print_stream->write((uint8_t) (dropped >> 8));
+            _print_stream->write((uint8_t) dropped);
+        }
+    }
+
+    if (all)
+    {
+        _print_stream->flush();
+    }
+}
+#else
+bool SEEL_Print::record(const uint8_t* rec, uint8_t len)
+{
+    return false;
+}
+
+void SEEL_Print::drain(bool all)
+{
+    if (_print_stream != NULL && all)
+    {
+        _print_stream->flush();
+    }
+}
+#endif // SEEL_LOG_DEFERRED_ENABLE
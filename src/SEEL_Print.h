@@ -14,6 +14,92 @@ File purpose:   Users can enable/disable SEEL debugging messages by initializing
 #include <Console.h>
 
 #include "SEEL_Params.h"
+#if SEEL_LOG_DEFERRED_ENABLE
+#include "SEEL_Ring.h"
+#include "SEEL_Ring.cpp" // cpp file required for templates
+#endif // SEEL_LOG_DEFERRED_ENABLE
+
+// Deferred log records: SEEL_LOG_RECORD_MARK, event ID, then a fixed size payload per event (multi-byte values big endian)
+// The mark is not ASCII, so records can be told apart from text output. See misc/SEEL_log_decoder.py
+const uint8_t SEEL_LOG_RECORD_MARK = 0xA5;
+const uint8_t SEEL_LOG_EVENT_DROPPED = 0; // Bytes dropped since the last drop record (2)
+const uint8_t SEEL_LOG_EVENT_SEND = 1; // Msg, start time (4), ToA (4)
+const uint8_t SEEL_LOG_EVENT_RECEIVE = 2; // Status (1, SEEL_LOG_RX_*), msg, length (1), SNR * 4 (1), RSSI (1), receive offset (4)
+const uint8_t SEEL_LOG_RX_VALID = 0;
+const uint8_t SEEL_LOG_RX_DUPLICATE = 1;
+const uint8_t SEEL_LOG_RX_WRONG_LENGTH = 2;
+
+#if SEEL_LOG_DEFERRED_ENABLE
+// Print target that holds output until SEEL_Print::drain(), drops (and counts) bytes that do not fit
+class SEEL_Print_Ring : public Print
+{
+public:
+    SEEL_Print_Ring() : _dropped(0) {}
+
+    using Print::write;
+    virtual size_t write(uint8_t b);
+
+    // Writes SEEL_LOG_RECORD_MARK and "len" bytes of "rec", or nothing if they do not all fit
+    bool write_record(const uint8_t* rec, uint8_t len);
+
+    // Moves up to "budget" bytes to "out", returns the number of bytes moved
+    uint16_t drain(Print* out, uint16_t budget);
+
+    bool empty() const { return _ring.empty(); }
+    uint16_t take_dropped() { uint16_t d = _dropped; _dropped = 0; return d; }
+
+private:
+    SEEL_Ring<uint8_t, SEEL_LOG_RING_SIZE, uint16_t> _ring; // 16-bit indices, only written and drained from tasks
+    uint16_t _dropped;
+};
+#endif // SEEL_LOG_DEFERRED_ENABLE
+
+// Allocation-free line builder, use in place of String to assemble output without touching the heap
+// Output that does not fit is cut off and flagged, the line always stays null-terminated
+// Storage is provided by SEEL_Print_Line_Storage, pass c_str() to SEEL_Print or any other Print target
+class SEEL_Print_Line
+{
+public:
+    SEEL_Print_Line& add(const char* s);
+    SEEL_Print_Line& add(const __FlashStringHelper* s);
+    SEEL_Print_Line& add(char c);
+
+    // Unsigned/signed decimal, same digits as print(v, DEC)
+    SEEL_Print_Line& add_dec(uint32_t v);
+    SEEL_Print_Line& add_dec_signed(int32_t v);
+
+    // Uppercase hex without prefix, zero-padded to at least "min_digits"
+    SEEL_Print_Line& add_hex(uint32_t v, uint8_t min_digits = 1);
+
+    // Each byte of "bytes" in decimal followed by "sep"
+    SEEL_Print_Line& add_bytes(const uint8_t* bytes, uint8_t len, char sep = ' ');
+
+    void clear();
+
+    const char* c_str() const {return _buf;}
+    uint8_t length() const {return _len;}
+    bool truncated() const {return _truncated;}
+
+protected:
+    SEEL_Print_Line(char* buf, uint8_t capacity);
+
+private:
+    char* _buf;
+    uint8_t _capacity;
+    uint8_t _len;
+    bool _truncated;
+};
+
+// Line of at most N - 1 characters, storage is part of the object
+template <uint8_t N>
+class SEEL_Print_Line_Storage : public SEEL_Print_Line
+{
+    static_assert(N > 1, "SEEL_Print_Line_Storage needs room for at least one character");
+public:
+    SEEL_Print_Line_Storage() : SEEL_Print_Line(_buf_ary, N) {}
+private:
+    char _buf_ary[N];
+};
 
 class SEEL_Print
 {
@@ -23,6 +109,18 @@ public:
         _print_stream = s;
     }
 
+    // True if statements of "category" at "level" are compiled in, see SEEL_LOG_MAX_LEVEL in SEEL_Params.h
+    static constexpr bool enabled(SEEL_LOG_CATEGORY category, SEEL_LOG_LEVEL level)
+    {
+        return level <= SEEL_LOG_MAX_LEVEL && (SEEL_LOG_CATEGORIES & category) != 0;
+    }
+
+    // True if output is buffered and records are accepted, see SEEL_LOG_DEFERRED_ENABLE
+    static constexpr bool deferred()
+    {
+        return SEEL_LOG_DEFERRED_ENABLE == TRUE;
+    }
+
     template<typename T>
     static size_t debug_value(T t)
     {
@@ -32,7 +130,7 @@ public:
         }
         
         SEEL_Print::print(F("DEBUG: "));
-        return _print_stream->println(t);
+        return out()->println(t);
     }
 
     template<typename T>
@@ -43,7 +141,7 @@ public:
             return 0;
         }
         
-        return _print_stream->print(t);
+        return out()->print(t);
     }
 
     template<typename T>
@@ -54,12 +152,21 @@ public:
             return 0;
         }
 
-        return _print_stream->println(t);
+        return out()->println(t);
     }
 
+    // Writes a binary record, "rec" holds a SEEL_LOG_EVENT_* ID followed by its payload
+    // Returns false if deferred logging is disabled or the record was dropped
+    static bool record(const uint8_t* rec, uint8_t len);
+
+    // Writes buffered output to the stream. If "all", blocks until everything is written and the stream is flushed,
+    // otherwise only writes what the stream takes without blocking. Without deferred logging, only flushes if "all"
+    static void drain(bool all);
+
+    // Blocks until output is written; with deferred logging, output stays buffered until drain()
     static void flush()
     {
-        if (_print_stream == NULL)
+        if (_print_stream == NULL || deferred())
         {
             return;
         }
@@ -70,7 +177,19 @@ public:
 private:
     SEEL_Print();
 
+    static Print* out()
+    {
+#if SEEL_LOG_DEFERRED_ENABLE
+        return &_ring;
+#else
+        return _print_stream;
+#endif // SEEL_LOG_DEFERRED_ENABLE
+    }
+
     static Stream* _print_stream;
+#if SEEL_LOG_DEFERRED_ENABLE
+    static SEEL_Print_Ring _ring;
+#endif // SEEL_LOG_DEFERRED_ENABLE
 };
 
-#endif // SEEL_Print_h
\ No newline at end of file
+#endif // SEEL_Print_h
@@ -9,80 +9,71 @@ File purpose:   See SEEL_Queue.h
 
 #include "SEEL_Queue.h"
 
-template <class T>
-SEEL_Queue<T>::SEEL_Queue()
+template <class T, uint16_t N>
+SEEL_Queue<T, N>::SEEL_Queue()
 {
     clear();
 }
 
-template <class T>
-void SEEL_Queue<T>::clear()
+template <class T, uint16_t N>
+void SEEL_Queue<T, N>::clear()
 {
     _q_size = 0;
     _q_pos = 0;
 }
 
-template <class T>
-T* SEEL_Queue<T>::front()
+template <class T, uint16_t N>
+T* SEEL_Queue<T, N>::front()
 {
     if (_q_size == 0)
     {
         return NULL;
     }
 
-    return &_content_ary_ptr[_q_pos];
+    return &_content_ary[_q_pos];
 }
 
-template <class T>
-void SEEL_Queue<T>::pop_front()
+template <class T, uint16_t N>
+void SEEL_Queue<T, N>::pop_front()
 {
     if (!empty())
     {
         --_q_size;
-        inc_q_pos();
+        _q_pos = wrap(_q_pos + 1);
     }
 }
 
-template <class T>
-void SEEL_Queue<T>::recycle_front()
+template <class T, uint16_t N>
+void SEEL_Queue<T, N>::recycle_front()
 {
     if (_q_size > 1) // If _q_size 1 or less, no change required
     {
-        if (_q_size == Q_MAX_SIZE) // Queue is full
+        if (_q_size < N)
         {
-            // If queue full, move _q_pos pointer to next element and 
-            // original element becomes end because of ring buffer structure
-            inc_q_pos();
-        }
-        else
-        {
-            uint32_t insert_index = _q_size + _q_pos;
-            insert_index = insert_index % Q_MAX_SIZE;
-            _content_ary_ptr[insert_index] = _content_ary_ptr[_q_pos];
-            inc_q_pos();
+            _content_ary[wrap(_q_pos + _q_size)] = _content_ary[_q_pos];
         }
+        // If queue full, the original element becomes the end because of ring buffer structure
+        _q_pos = wrap(_q_pos + 1);
     }
 }
 
-template <class T>
-uint8_t SEEL_Queue<T>::remove(const T& val)
+template <class T, uint16_t N>
+typename SEEL_Queue<T, N>::index_t SEEL_Queue<T, N>::remove(const T& val)
 {
-    uint32_t move_inc = 0;
-    // Remove values by shifting post-values up
-    for (uint32_t i = 0; i < _q_size; ++i)
+    index_t move_inc = 0;
+    // Remove values by shifting later values towards the front
+    for (index_t i = 0; i < _q_size; ++i)
     {
-        uint32_t current_index = (_q_pos + i) % Q_MAX_SIZE;
-        if (_content_ary_ptr[current_index + move_inc] == val)
+        index_t current_index = wrap(_q_pos + i);
+        if (_content_ary[current_index] == val)
         {
             ++move_inc;
             continue; // So we don't move removed values
         }
 
-        // New attempt to move present to past values instead of present to future 
         if (move_inc > 0)
         {
-            uint32_t new_index = (current_index - move_inc) % Q_MAX_SIZE;
-            _content_ary_ptr[new_index] = _content_ary_ptr[current_index];
+            _content_ary[wrap(_q_pos + i - move_inc)] = _content_ary[current_index];
         }
     }
     _q_size -= move_inc;
@@ -90,25 +81,25 @@ uint8_t SEEL_Queue<T>::remove(const T& val)
     return move_inc;
 }
 
-template <class T>
-bool SEEL_Queue<T>::add(const T& val, bool wrap)
+template <class T, uint16_t N>
+bool SEEL_Queue<T, N>::add(const T& val, bool wrap_add)
 {
-    if ( _q_size >= Q_MAX_SIZE)
+    if (_q_size >= N)
     {
-        SEEL_Print::print(F("QUEUE FULL, SIZE: ")); 
-        SEEL_Print::println(_q_size);
+        if (SEEL_Print::enabled(SEEL_LOG_QUEUE, SEEL_LOG_LEVEL_ERROR))
+        {
+            SEEL_Print::print(F("QUEUE FULL, SIZE: ")); 
+            SEEL_Print::println(_q_size);
 
-        SEEL_Print::flush();
-        if(wrap) {
+            SEEL_Print::flush();
+        }
+        if (wrap_add) {
             pop_front();
         }
     }
-
     else 
     {
-        uint32_t insert_index = _q_size + _q_pos;
-        insert_index = insert_index % Q_MAX_SIZE;
-        _content_ary_ptr[insert_index] = val;
+        _content_ary[wrap(_q_pos + _q_size)] = val;
         ++_q_size;
         return true;
     }
@@ -116,23 +107,26 @@ bool SEEL_Queue<T>::add(const T& val, bool wrap)
     return false;
 }
 
-template <class T>
-T* SEEL_Queue<T>::find(const T& val)
+template <class T, uint16_t N>
+T* SEEL_Queue<T, N>::find(const T& val)
 {
-    for (uint32_t i = 0; i < _q_size; ++i)
+    for (iterator it = begin(); it != end(); ++it)
     {
-        uint32_t current_index = (_q_pos + i) % Q_MAX_SIZE;
-        if (_content_ary_ptr[current_index] == val)
+        if (*it == val)
         {
-            return &_content_ary_ptr[current_index];
+            return &*it;
         }
     }
 
     return NULL;
 }
 
-template<class T>
-void SEEL_Queue<T>::print() {
+template <class T, uint16_t N>
+void SEEL_Queue<T, N>::print() {
+    if (!SEEL_Print::enabled(SEEL_LOG_QUEUE, SEEL_LOG_LEVEL_DEBUG))
+    {
+        return;
+    }
 
     SEEL_Print::print(F("SIZE: "));
     SEEL_Print::print(_q_size);
@@ -140,26 +134,12 @@ void SEEL_Queue<T>::print() {
     SEEL_Print::print(_q_pos);
     SEEL_Print::print(F(" [ "));
 
-    int first_len = (_q_pos + _q_size > Q_MAX_SIZE) ? Q_MAX_SIZE:
-         _q_pos + _q_size;
-
-     for (uint8_t i = _q_pos; i < first_len; ++i) {
-         SEEL_Print::print(_content_ary_ptr[i]);
-         SEEL_Print::print(F(" "));
-     }
-
-    // wrap print
-     if (_q_pos+_q_size > Q_MAX_SIZE) {
-            int adj_len =  _q_pos + _q_size - Q_MAX_SIZE;
-            for (uint8_t i = 0; i < adj_len; ++i) {
-                SEEL_Print::print(_content_ary_ptr[i]);
-                SEEL_Print::print(F(" "));
-            }
-     }
+    for (iterator it = begin(); it != end(); ++it)
+    {
+        SEEL_Print::print(*it);
+        SEEL_Print::print(F(" "));
+    }
 
     SEEL_Print::println(F("]"));
     SEEL_Print::flush();
 }
-
-
-
@@ -13,17 +13,51 @@ File purpose:   Queue implementation based on ring buffered arrays
 #include "SEEL_Params.h"
 #include "SEEL_Print.h"
 
-template <class T>
+// Selects type "A" if "cond" is true, otherwise type "B"
+template <bool cond, class A, class B>
+struct SEEL_Type_Select {typedef A type;};
+template <class A, class B>
+struct SEEL_Type_Select<false, A, B> {typedef B type;};
+
+// Ring buffer queue holding up to N elements, storage is part of the queue object
+// Indices use the smallest type that fits N; if N is a power of two, wraparound is a mask
+template <class T, uint16_t N>
 class SEEL_Queue
 {
+    static_assert(N > 0 && N <= INT16_MAX, "SEEL_Queue capacity must be between 1 and INT16_MAX");
 public:
-    // Getters & Setters
-    bool empty() { return _q_size == 0; }
-    uint8_t size() { return _q_size; }
-    uint8_t max_size() {return Q_MAX_SIZE; }
+    // Typedefs
+    typedef typename SEEL_Type_Select<(N <= UINT8_MAX), uint8_t, uint16_t>::type index_t;
+
+    // Iterates from the front to the back of the queue
+    // Adding or removing elements invalidates iterators
+    class iterator
+    {
+    public:
+        iterator(SEEL_Queue* q, index_t i) : _q(q), _i(i) {}
+        T& operator*() {return _q->_content_ary[wrap(_q->_q_pos + _i)];}
+        T* operator->() {return &**this;}
+        iterator& operator++() {++_i; return *this;}
+        bool operator!=(const iterator& other) const {return _i != other._i;}
+    private:
+        SEEL_Queue* _q;
+        index_t _i; // Offset from the front
+    };
 
     // ***************************************************
     // Member functions
+
+    // Constructor
+    SEEL_Queue();
+
+    // Getters & Setters
+    bool empty() { return _q_size == 0; }
+    index_t size() { return _q_size; }
+    index_t max_size() {return N; }
+
+    iterator begin() {return iterator(this, 0);}
+    iterator end() {return iterator(this, _q_size);}
+
     // Resets all class member variables which clears queue
     void clear();
 
@@ -39,7 +73,7 @@ public:
 
     // Removes elements from queue that "==" val.
     // Returns number of removed elements.
-    uint8_t remove(const T& val);
+    index_t remove(const T& val);
 
     // Adds element to queue. Returns true if add was successful. If wrap is true, replaces oldest element in queue
     bool add(const T& val, bool wrap = false);
@@ -49,60 +83,32 @@ public:
 
     void print();
 
-protected:
-    // Constructor, prevent instatiation
-    SEEL_Queue();
-
+private:
     // ***************************************************
     // Member functions
-    void inc_q_pos() 
+
+    // Maps "i" (less than 2 * N) into the content array
+    static index_t wrap(uint16_t i)
     {
-        ++_q_pos;
-        if (_q_pos >= Q_MAX_SIZE)
+        if ((N & (N - 1)) == 0)
         {
-            _q_pos -= Q_MAX_SIZE;
+            return i & (N - 1);
         }
+        return (i >= N) ? i - N : i;
     }
 
     // ***************************************************
     // Member variables
-    uint32_t _q_pos;
-    uint32_t _q_size;
-    T* _content_ary_ptr;
-    uint32_t Q_MAX_SIZE;
+    T _content_ary[N];
+    index_t _q_pos;
+    index_t _q_size;
 };
 
-template <class T> 
-class SEEL_Default_Queue : public SEEL_Queue<T> {
-private:
-    T content_ary[SEEL_DEFAULT_QUEUE_SIZE];
-public:
-    SEEL_Default_Queue() {
-        this->_content_ary_ptr = content_ary;
-        this->Q_MAX_SIZE = SEEL_DEFAULT_QUEUE_SIZE;
-    }
-};
-
-template <class T> 
-class SEEL_SNode_Msg_Queue : public SEEL_Queue<T> {
-private:
-    T content_ary[SEEL_SNODE_MSG_QUEUE_SIZE];
-public:
-    SEEL_SNode_Msg_Queue() {
-        this->_content_ary_ptr = content_ary;
-        this->Q_MAX_SIZE = SEEL_SNODE_MSG_QUEUE_SIZE;
-    }
-};
+// Queue sizes used in SEEL
+template <class T>
+using SEEL_Default_Queue = SEEL_Queue<T, SEEL_DEFAULT_QUEUE_SIZE>;
 
-template <class T> 
-class SEEL_Sched_Queue : public SEEL_Queue<T> {
-private:
-    T content_ary[SEEL_SCHED_QUEUE_SIZE];
-public:
-    SEEL_Sched_Queue() {
-        this->_content_ary_ptr = content_ary;
-        this->Q_MAX_SIZE = SEEL_SCHED_QUEUE_SIZE;
-    }
-};
+template <class T>
+using SEEL_SNode_Msg_Queue = SEEL_Queue<T, SEEL_SNODE_MSG_QUEUE_SIZE>;
 
-#endif // SEEL_Queue_h
\ No newline at end of file
+#endif // SEEL_Queue_h
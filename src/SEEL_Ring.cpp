@@ -0,0 +1,58 @@
+/*
+The SEEL repository can be found at: https://github.com/SEEL-Group/SEEL
+Copyright (C) SEEL Group 2021 all rights reserved
+See license file in root folder for more licensing details
+See SEEL_documentation.pdf for protocol description details
+
+File purpose:   See SEEL_Ring.h
+*/
+
+#ifndef SEEL_Ring_cpp
+#define SEEL_Ring_cpp // Included by SEEL_Defines.h and SEEL_Print.h
+
+#include "SEEL_Ring.h"
+
+// Prevents the compiler from moving element accesses across index updates
+#define SEEL_RING_BARRIER() __asm__ __volatile__("" ::: "memory")
+
+template <class T, uint16_t N, class I>
+T* SEEL_Ring<T, N, I>::push_slot()
+{
+    if (full())
+    {
+        return NULL;
+    }
+
+    return &_content_ary[_head & (N - 1)];
+}
+
+template <class T, uint16_t N, class I>
+void SEEL_Ring<T, N, I>::push_commit()
+{
+    SEEL_RING_BARRIER(); // Element must be written before it is published
+    _head = _head + 1;
+}
+
+template <class T, uint16_t N, class I>
+T* SEEL_Ring<T, N, I>::front()
+{
+    if (empty())
+    {
+        return NULL;
+    }
+
+    SEEL_RING_BARRIER(); // Element must not be read before _head is checked
+    return &_content_ary[_tail & (N - 1)];
+}
+
+template <class T, uint16_t N, class I>
+void SEEL_Ring<T, N, I>::pop_front()
+{
+    if (!empty())
+    {
+        SEEL_RING_BARRIER(); // Element must be fully read before the slot is released
+        _tail = _tail + 1;
+    }
+}
+
+#endif // SEEL_Ring_cpp
@@ -0,0 +1,69 @@
+/*
+The SEEL repository can be found at: https://github.com/SEEL-Group/SEEL
+Copyright (C) SEEL Group 2021 all rights reserved
+See license file in root folder for more licensing details
+See SEEL_documentation.pdf for protocol description details
+
+File purpose:   Lock-free single-producer/single-consumer ring, used to pass data from ISRs to tasks
+*/
+
+#ifndef SEEL_Ring_h
+#define SEEL_Ring_h
+
+#include "SEEL_Params.h"
+
+// The producer (ISR) only writes _head and the consumer (task) only writes _tail, so no locking is needed
+// as long as index reads/writes are atomic (single byte) and there is exactly one producer and one consumer
+// Elements are written/read in place to avoid copying from ISR context
+// Index type "I" bounds the size to half its range; indices wider than a byte are not atomic on 8-bit MCUs,
+// so only use them when producer and consumer never interrupt each other (e.g. both run in tasks)
+template <class T, uint16_t N, class I = uint8_t>
+class SEEL_Ring
+{
+    static_assert(N > 0 && N <= (I) ~(I) 0 / 2 + 1 && (N & (N - 1)) == 0, "SEEL_Ring size must be a power of two, max half the index range");
+
+public:
+    // Constructor
+    SEEL_Ring() : _head(0), _tail(0) {}
+
+    // Getters & Setters
+    bool empty() const { return _head == _tail; }
+    bool full() const { return (I)(_head - _tail) >= N; }
+    I size() const { return (I)(_head - _tail); }
+    I max_size() const { return N; }
+
+    // ***************************************************
+    // Producer functions
+
+    // Returns the slot to write the next element into, or NULL if the ring is full
+    // The element is not visible to the consumer until push_commit() is called
+    T* push_slot();
+
+    // Publishes the element written into push_slot()
+    void push_commit();
+
+    // ***************************************************
+    // Consumer functions
+
+    // Returns a pointer to the oldest element, or NULL if the ring is empty
+    T* front();
+
+    // Releases the oldest element back to the producer
+    void pop_front();
+
+    // Drops all elements; only call from the consumer side
+    void clear() { _tail = _head; }
+
+    // Returns the i-th storage slot regardless of the ring state, to set up slots before the producer starts
+    T* slot(I i) { return &_content_ary[i]; }
+
+private:
+    // ***************************************************
+    // Member variables
+    T _content_ary[N];
+    // Free-running indices, wrapped with (N - 1) mask on access
+    volatile I _head;
+    volatile I _tail;
+};
+
+#endif // SEEL_Ring_h
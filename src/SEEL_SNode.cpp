@@ -12,12 +12,15 @@ File purpose:   See SEEL_SNode.h
 uint32_t SEEL_SNode::generate_id()
 {
     // Make sure GNode is configured to handle ID size and there are enough bits in message protocol
-    uint32_t largest_id = min(pow(2, SEEL_MSG_TARG_SIZE * 8), SEEL_MAX_NODES);
+    uint32_t largest_id = min((uint32_t) 1 << (SEEL_MSG_TARG_SIZE * 8), SEEL_MAX_NODES);
     // Make sure ID is not 0, since Gnode is ID 0
     uint32_t new_id = random(1, largest_id);
     _id_verified = false;
 
-    SEEL_Print::print(F("New NODE ID: ")); SEEL_Print::println(new_id); SEEL_Print::flush();
+    if (SEEL_Print::enabled(SEEL_LOG_ROUTING, SEEL_LOG_LEVEL_INFO))
+    {
+        SEEL_Print::print(F("New NODE ID: ")); SEEL_Print::println(new_id); SEEL_Print::flush();
+    }
 
     return new_id;
 }
@@ -29,7 +32,7 @@ void SEEL_SNode::init(  SEEL_Scheduler* ref_scheduler,
             uint8_t cs_pin, uint8_t reset_pin, uint8_t int_pin, 
             uint32_t snode_id, uint32_t tdma_slot)
 {
-    SEEL_Node::init((snode_id == SEEL_GNODE_ID) ? generate_id() : snode_id, tdma_slot);
+    SEEL_Node::init((snode_id == SEEL_GNODE_ID) ? generate_id() : snode_id, tdma_slot, &_snode_msg_pool);
     rfm_param_init(cs_pin, reset_pin, int_pin, SEEL_RFM95_SNODE_TX, SEEL_RFM95_SNODE_CR);
 
     // Initialize member variables
@@ -45,11 +48,20 @@ void SEEL_SNode::init(  SEEL_Scheduler* ref_scheduler,
     _missed_bcasts = 0;
     _missed_msgs = 0;
     _last_parent = 0;
+    _expected_wtb_millis = 0;
+    _bcast_slot = SEEL_TDMA_SLOTS;
+    _wake_shift_hops = 0;
     _id_verified = false;
     _system_sync = false;
     _acked = true;
     _WD_adjusted = false;
     _data_queue_ptr = &_snode_data_queue;
+#if SEEL_EARLY_SLEEP_ENABLE
+    _early_sleep_millis = 0;
+    _child_count = 0;
+    _children_overflow = false;
+    _early_sleep_armed = false;
+#endif // SEEL_EARLY_SLEEP_ENABLE
 
     // Set task instances
     _task_wake.set_inst(this);
@@ -57,8 +69,14 @@ void SEEL_SNode::init(  SEEL_Scheduler* ref_scheduler,
     _task_parent_lock.set_inst(this);
     _task_enqueue_msg.set_inst(this);
     _task_user.set_inst(this);
-    _task_sleep.set_inst(this);
-    _task_force_sleep.set_inst(this);
+    _task_sleep.set_inst(this, SEEL_Task::PRIORITY_CRITICAL);
+    _task_force_sleep.set_inst(this, SEEL_Task::PRIORITY_CRITICAL);
+#if SEEL_EARLY_SLEEP_ENABLE
+    _task_early_sleep.set_inst(this);
+#endif // SEEL_EARLY_SLEEP_ENABLE
+#if SEEL_CAD_ENABLE
+    _task_cad.set_inst(this);
+#endif // SEEL_CAD_ENABLE
 
     bool added = _ref_scheduler->add_task(&_task_wake);
     SEEL_Assert::assert(added, SEEL_ASSERT_FILE_NUM_SNODE, __LINE__);
@@ -66,17 +84,25 @@ void SEEL_SNode::init(  SEEL_Scheduler* ref_scheduler,
 
 void SEEL_SNode::SEEL_Task_SNode_Wake::run()
 {
-    SEEL_Print::println(F("Wake"));
+    if (SEEL_Print::enabled(SEEL_LOG_SLEEP, SEEL_LOG_LEVEL_INFO))
+    {
+        SEEL_Print::println(F("Wake"));
+    }
     _inst->_cb_info.wtb_millis = millis();
-    _inst->_msg_send_delay = 0;
+    _inst->_mac.reset();
     _inst->_unack_msgs = 0;
     _inst->_CRC_fails = 0;
     _inst->_bcast_received = false;
     _inst->_parent_sync = false;
     _inst->_cb_info.first_callback = true; // Allows ability to only send 1 message per cycle
     _inst->_bcast_avail = false;
+    _inst->_msg_pool_ptr->release(_inst->_bcast_handle); // Unsent bcast of the previous cycle
+    _inst->_bcast_handle = SEEL_MSG_NO_HANDLE;
     _inst->_bcast_sent = false; // Set to true in SEEL_Node.cpp when bcast msg sent out
     _inst->_parent_lock = false;
+#if SEEL_SCHED_STATS_ENABLE
+    _inst->_ref_scheduler->reset_stats(); // Measure the awake window only
+#endif // SEEL_SCHED_STATS_ENABLE
 
     _inst->_cycle_transmissions.clear();
     _inst->_queue_dropped_msgs_self = 0;
@@ -90,23 +116,48 @@ void SEEL_SNode::SEEL_Task_SNode_Wake::run()
 
     // Clear ack queue
     _inst->_ack_queue.clear();
+#if SEEL_EARLY_SLEEP_ENABLE
+    _inst->children_new_cycle();
+    _inst->_early_sleep_armed = false;
+#endif // SEEL_EARLY_SLEEP_ENABLE
+#if SEEL_RX_GATE_ENABLE
+    _inst->_rx_slot_mask_prev = _inst->_rx_slot_mask;
+    _inst->_rx_slot_mask = 0;
+#endif // SEEL_RX_GATE_ENABLE
 
     // Disables user tasks from running until critical LoRa tasks are done
     _inst->_ref_scheduler->set_user_task_enable(false); 
 
+    // Start listening, packets from before sleep are dropped
+    _inst->rfm_receive_start();
+
     // Add cycle tasks to scheduler
     bool added = _inst->_ref_scheduler->add_task(&_inst->_task_receive);
     SEEL_Assert::assert(added, SEEL_ASSERT_FILE_NUM_SNODE, __LINE__);
+    added = _inst->_ref_scheduler->add_event_task(&_inst->_task_tx_done, SEEL_SCHED_EVENT_TX_DONE);
+    SEEL_Assert::assert(added, SEEL_ASSERT_FILE_NUM_SNODE, __LINE__);
+#if SEEL_CAD_ENABLE
+    // Missed bcasts may mean CAD is not working here (e.g. too weak a link), keep receiving then
+    _inst->_cad_false_detects = 0;
+    if (_inst->_missed_bcasts < SEEL_CAD_MISSED_BCAST_LIMIT)
+    {
+        _inst->_task_cad.co_reset();
+        added = _inst->_ref_scheduler->add_task(&_inst->_task_cad);
+        SEEL_Assert::assert(added, SEEL_ASSERT_FILE_NUM_SNODE, __LINE__);
+    }
+#endif // SEEL_CAD_ENABLE
 
     // Force sleep, so SNODE can sleep even if it misses the bcast
     // Cannot force sleep until WD timer is properly adjusted
     // After SEEL_FORCE_SLEEP_RESET_COUNT of missed bcasts, disable forced sleep
     if(_inst->_WD_adjusted && _inst->_missed_bcasts < SEEL_FORCE_SLEEP_RESET_COUNT)
     {
-        added = _inst->_ref_scheduler->add_task(&_inst->_task_force_sleep,
-            SEEL_FORCE_SLEEP_AWAKE_MULT * _inst->_snode_awake_time_secs * SEEL_SECS_TO_MILLIS *
-            pow(SEEL_FORCE_SLEEP_AWAKE_DURATION_SCALE, _inst->_missed_bcasts + 1));
-        SEEL_Assert::assert(added, SEEL_ASSERT_FILE_NUM_SNODE, __LINE__);
+        SEEL_Q16 awake_scale = SEEL_Fixed::mul(SEEL_FORCE_SLEEP_AWAKE_MULT_Q16,
+            SEEL_Fixed::pow(SEEL_FORCE_SLEEP_AWAKE_DURATION_SCALE_Q16, _inst->_missed_bcasts + 1));
+        uint64_t force_sleep_millis = SEEL_Fixed::scale(_inst->_snode_awake_time_secs * SEEL_SECS_TO_MILLIS, awake_scale);
+        SEEL_Assert::assert(force_sleep_millis <= UINT32_MAX, SEEL_ASSERT_FILE_NUM_SNODE, __LINE__);
+        _inst->_force_sleep_handle = _inst->_ref_scheduler->add_task(&_inst->_task_force_sleep, force_sleep_millis);
+        SEEL_Assert::assert(_inst->_force_sleep_handle, SEEL_ASSERT_FILE_NUM_SNODE, __LINE__);
     }
     else
     {
@@ -128,35 +179,25 @@ void SEEL_SNode::bcast_setup(SEEL_Message &msg, uint32_t receive_offset)
 
     /* Update system with values from bcast, values stored in Big Endian (MSB in lower address) */
     
-    // Update local time, transmission delay is accounted for on sender side
+    // Update network time, transmission delay is accounted for on sender side
     // Account for reception time via receive offset, the time taken in the rfm receive method
-    uint32_t millis_update = 0;
-    millis_update += (uint32_t)msg.data[SEEL_MSG_DATA_TIME_SYNC_INDEX] << 24;
-    millis_update += (uint32_t)msg.data[SEEL_MSG_DATA_TIME_SYNC_INDEX + 1] << 16;
-    millis_update += (uint32_t)msg.data[SEEL_MSG_DATA_TIME_SYNC_INDEX + 2] << 8;
-    millis_update += (uint32_t)msg.data[SEEL_MSG_DATA_TIME_SYNC_INDEX + 3];
+    uint32_t millis_update = SEEL_Wire_Bcast::Time_Sync::get(msg.data);
     millis_update += receive_offset;
     _ref_scheduler->adjust_time(millis_update);
 
     // Bcast will be modified such that sender becomes this node
     _bcast_received = true; // resets every cycle
 
+    // No need to force sleep, sleep is scheduled below
+    _ref_scheduler->cancel_task(_force_sleep_handle);
+
     // SEEL_MSG_DATA_FIRST_BCAST_INDEX index is 1 if first bcast, otherwise 0
     // system_sync should only be true if it was previously sync'd and the msg is NOT a first_bcast
-    _system_sync &= (msg.data[SEEL_MSG_DATA_FIRST_BCAST_INDEX] != SEEL_BCAST_FB);
+    _system_sync &= (SEEL_Wire_Bcast::First_Bcast::get(msg.data) != SEEL_BCAST_FB);
 
     // Update awake time, stored time in seconds, big Endian
-    _snode_awake_time_secs = 0;
-    _snode_awake_time_secs += (uint32_t)msg.data[SEEL_MSG_DATA_AWAKE_TIME_SECONDS_INDEX] << 24;
-    _snode_awake_time_secs += (uint32_t)msg.data[SEEL_MSG_DATA_AWAKE_TIME_SECONDS_INDEX + 1] << 16;
-    _snode_awake_time_secs += (uint32_t)msg.data[SEEL_MSG_DATA_AWAKE_TIME_SECONDS_INDEX + 2] << 8;
-    _snode_awake_time_secs += (uint32_t)msg.data[SEEL_MSG_DATA_AWAKE_TIME_SECONDS_INDEX + 3];
-
-    _snode_sleep_time_secs = 0;
-    _snode_sleep_time_secs += (uint32_t)msg.data[SEEL_MSG_DATA_SLEEP_TIME_SECONDS_INDEX] << 24;
-    _snode_sleep_time_secs += (uint32_t)msg.data[SEEL_MSG_DATA_SLEEP_TIME_SECONDS_INDEX + 1] << 16;
-    _snode_sleep_time_secs += (uint32_t)msg.data[SEEL_MSG_DATA_SLEEP_TIME_SECONDS_INDEX + 2] << 8;
-    _snode_sleep_time_secs += (uint32_t)msg.data[SEEL_MSG_DATA_SLEEP_TIME_SECONDS_INDEX + 3];
+    _snode_awake_time_secs = SEEL_Wire_Bcast::Awake_Secs::get(msg.data);
+    _snode_sleep_time_secs = SEEL_Wire_Bcast::Sleep_Secs::get(msg.data);
 
     // Add sleep ASAP to keep awake time accurate, should be done AFTER local and awake times are updated
     // Parenting off a new SNODE parent may cause delays to miss original nodes
@@ -171,59 +212,87 @@ void SEEL_SNode::bcast_setup(SEEL_Message &msg, uint32_t receive_offset)
     awake_offset = min(awake_offset, _snode_awake_time_secs * SEEL_SECS_TO_MILLIS); // Safety to prevent uint32 wraparound
     SEEL_Print::print(F("DEBUG: AWAKE OFFSET: ")); SEEL_Print::println(awake_offset);
     */
-    bool added = _ref_scheduler->add_task(&_task_sleep, _snode_awake_time_secs * SEEL_SECS_TO_MILLIS); // - awake_offset); // Delay sleep task by time node should be awake
-    SEEL_Assert::assert(added, SEEL_ASSERT_FILE_NUM_SNODE, __LINE__);
+    _sleep_handle = _ref_scheduler->add_task(&_task_sleep, _snode_awake_time_secs * SEEL_SECS_TO_MILLIS); // - awake_offset); // Delay sleep task by time node should be awake
+    SEEL_Assert::assert(_sleep_handle, SEEL_ASSERT_FILE_NUM_SNODE, __LINE__);
+#if SEEL_EARLY_SLEEP_ENABLE
+    _sleep_due_millis = millis() + _snode_awake_time_secs * SEEL_SECS_TO_MILLIS;
+#endif // SEEL_EARLY_SLEEP_ENABLE
 }
 
 void SEEL_SNode::SEEL_Task_SNode_Receive::run()
 {
-    SEEL_Message msg;
-    int8_t msg_rssi;
-    uint32_t receive_offset;
-    // Check if there is a message available
-    if(!_inst->rfm_receive_msg(&msg, msg_rssi, receive_offset)) // Stores the returned msg in msg
-    {
-        // No message is available
-        bool added = _inst->_ref_scheduler->add_task(&_inst->_task_receive);
-        SEEL_Assert::assert(added, SEEL_ASSERT_FILE_NUM_SNODE, __LINE__);
-        return;
+    // Process every packet captured by the receive ISR since the last run
+    while (_inst->rfm_msg_avail())
+    {
+        int8_t msg_rssi;
+        uint32_t receive_offset;
+
+        // Msg is handled in place in the receive ring, then released back to the receive ISR
+        SEEL_Message* msg = _inst->rfm_receive_msg(msg_rssi, receive_offset);
+        if (msg != NULL)
+        {
+            _inst->handle_msg(msg, msg_rssi, receive_offset);
+        }
+        _inst->rfm_receive_release();
     }
 
-    // Message is available
+    // Run again once the receive ISR captures another packet
+    bool added = _inst->_ref_scheduler->add_event_task(&_inst->_task_receive, SEEL_SCHED_EVENT_RX);
+    SEEL_Assert::assert(added, SEEL_ASSERT_FILE_NUM_SNODE, __LINE__);
+}
 
+bool SEEL_SNode::rfm_header_accept(const SEEL_Message* header)
+{
+    // Bcast and ACK msgs are handled regardless of target, other msgs only if targeted to this node
+    return header->cmd == SEEL_CMD_BCAST || header->cmd == SEEL_CMD_ACK || header->targ_id == _node_id;
+}
+
+void SEEL_SNode::handle_msg(SEEL_Message* msg, int8_t msg_rssi, uint32_t receive_offset)
+{
     /* There are three types of received available msgs:
         1) Bcast message, check this for information and time sync
         2) Acknowledgement messages, can pop most recent message from the msg queue
         3) Messages intended for another node, forward these
     */
 
+#if SEEL_RX_GATE_ENABLE
+    // The parent's ACKs (also those for other children) tell its TDMA slot
+    if (msg->cmd == SEEL_CMD_ACK && msg->send_id == _parent_id && _parent_sync)
+    {
+        _rx_parent_slot = rfm_rx_slot(receive_offset);
+    }
+#endif // SEEL_RX_GATE_ENABLE
+
     // Prioritize bcast check over everything else
     // Possible to receive bcast msgs from multiple nodes; action depends on parent selection mode
     // Only respond to bcast msgs while parent selection not locked
-    if(msg.cmd == SEEL_CMD_BCAST && !_inst->_parent_lock)
+    if(msg->cmd == SEEL_CMD_BCAST && !_parent_lock)
     {
         // "_acked" is only false here if the node never slept last cycle. Used to check if we never slept and received another bcast (missed a cycle)
         // acked may get set to false when node receives multiple bcasts in the same cycle (from diff nodes due to the blacklist system),
         // thus use the bcast's SEEL_MSG_DATA_BCAST_COUNT field to differentiate between different cycle bcasts
-        uint8_t bcast_count = msg.data[SEEL_MSG_DATA_BCAST_COUNT_INDEX];
-        if(!_inst->_acked && _inst->_cb_info.bcast_count != bcast_count)
+        uint8_t bcast_count = SEEL_Wire_Bcast::Bcast_Count::get(msg->data);
+        if(!_acked && _cb_info.bcast_count != bcast_count)
         {
             // If no bcast was received, clear the blacklist to try previously blacklisted nodes
-            SEEL_Print::println(F("Blacklist clear")); // Blacklist: clear
-            _inst->_bcast_blacklist.clear();
+            if (SEEL_Print::enabled(SEEL_LOG_ROUTING, SEEL_LOG_LEVEL_INFO))
+            {
+                SEEL_Print::println(F("Blacklist clear")); // Blacklist: clear
+            }
+            _bcast_blacklist.clear();
         }
-        if(!_inst->_parent_sync)
+        if(!_parent_sync)
         {
-            _inst->_acked = false;
+            _acked = false;
         }
-        _inst->_cb_info.bcast_count = bcast_count;
+        _cb_info.bcast_count = bcast_count;
 
         // Actions to do on the first bcast received
-        if (!_inst->_bcast_received)
+        if (!_bcast_received)
         {
             // Reset missed bcasts once we've received a bcast, even if it's from a blacklisted node
-            _inst->_cb_info.missed_bcasts = _inst->_missed_bcasts;
-            _inst->_missed_bcasts = 0;
+            _cb_info.missed_bcasts = _missed_bcasts;
+            _missed_bcasts = 0;
         }
 
         // Check to make sure sender is not in the broadcast blacklist. A blacklist is needed because
@@ -232,97 +301,101 @@ void SEEL_SNode::SEEL_Task_SNode_Receive::run()
         // ensures previous parents that could not be reached are not tried again. The blacklist is cleared
         // if no one was able to reach this node; thus, a parent is not permanently blocked if it's
         // the only possible solution
-        if(_inst->_bcast_blacklist.find(msg.send_id) == NULL)
+        if(_bcast_blacklist.find(msg->send_id) == NULL)
         {
             // Check if this bcast node should become new parent
-            uint32_t incoming_hop_count = msg.data[SEEL_MSG_DATA_HOP_COUNT_INDEX] + 1;
+            uint32_t incoming_hop_count = SEEL_Wire_Bcast::Hop_Count::get(msg->data) + 1;
             bool new_parent = false;
 
-            // PSEL == FIRST_BROADCAST will only take the first parent
-            if(SEEL_PSEL_MODE == SEEL_PSEL_FIRST_BROADCAST)
+            // The first parent is always taken; collecting policies replace it with (heuristically) better parents
+            // within an interval (SEEL_PSEL_DURATION_MILLIS), see SEEL_Policies.h
+            int8_t rssi_mode_value = SEEL_PSel::metric(msg_rssi, (int8_t) SEEL_Wire_Bcast::RSSI::get(msg->data));
+            if(!_parent_sync || SEEL_PSel::better(rssi_mode_value, incoming_hop_count, _path_rssi, _cb_info.hop_count))
             {
-                if(!_inst->_parent_sync)
-                {
-                    _inst->_parent_id = msg.send_id;
-                    _inst->_path_rssi = msg_rssi;
-                    _inst->_cb_info.hop_count = incoming_hop_count;
-                    new_parent = true;
-                }
-            } 
-            else // Other modes will replace the current parent for (heuristically) better parents, within an interval (SEEL_PSEL_DURATION_MILLIS)
+                _parent_id = msg->send_id;
+                _cb_info.hop_count = incoming_hop_count;
+                _path_rssi = rssi_mode_value;
+                new_parent = true;
+            }
+
+            if(new_parent)
             {
-                int8_t rssi_mode_value = 0;
-                if(SEEL_PSEL_MODE == SEEL_PSEL_IMMEDIATE_RSSI)
+                _acked = false;
+                // Keep the received bcast to forward it, replacing a bcast from a previous parent
+                _msg_pool_ptr->release(_bcast_handle);
+                _bcast_handle = rfm_receive_adopt();
+                _bcast_avail = (_bcast_handle != SEEL_MSG_NO_HANDLE);
+                send_ready();
+                _cb_info.parent_rssi = _path_rssi;
+#if SEEL_RX_GATE_ENABLE
+                _rx_parent_slot = SEEL_TDMA_SLOTS; // Learned again from the new parent's ACKs
+#endif // SEEL_RX_GATE_ENABLE
+                if (_parent_sync)
                 {
-                    rssi_mode_value = msg_rssi;
-                } 
-                else if(SEEL_PSEL_MODE == SEEL_PSEL_PATH_RSSI)
-                {
-                    int8_t incoming_rssi = msg.data[SEEL_MSG_DATA_RSSI_INDEX];
-                    rssi_mode_value = min(msg_rssi, incoming_rssi);
+                    // Parent replaced within the collection interval, its bcast timing is unknown
+                    _bcast_slot = SEEL_TDMA_SLOTS;
+                    _wake_shift_hops = _cb_info.hop_count - 1;
                 }
-
-                // A new parent is considered better if:
-                if(!_inst->_parent_sync || // Snode has no current
-                    (incoming_hop_count >= _inst->_cb_info.hop_count && // Or (incoming parent has a LOWER OR EQUAL hop count (prevents cycles from forming)
-                    rssi_mode_value > _inst->_path_rssi)) // AND it has a higher (stronger) RSSI heuristic)
+                if (SEEL_Print::enabled(SEEL_LOG_ROUTING, SEEL_LOG_LEVEL_INFO))
                 {
-                    _inst->_parent_id = msg.send_id;
-                    _inst->_cb_info.hop_count = incoming_hop_count;
-                    _inst->_path_rssi = rssi_mode_value;
-                    new_parent = true;
+                    SEEL_Print::print(F("Parent: ")); // Parent
+                    SEEL_Print::print(_parent_id);
+                    SEEL_Print::print(F(", RSSI metric: ")); // RSSI
+                    SEEL_Print::print(_path_rssi);
+                    SEEL_Print::print(F(", Hop Count: "));
+                    SEEL_Print::println(_cb_info.hop_count); // Hop Count
                 }
             }
 
-            if(new_parent)
-            {
-                _inst->_acked = false;
-                _inst->_bcast_msg = msg;
-                _inst->_bcast_avail = true;
-                _inst->_cb_info.parent_rssi = _inst->_path_rssi;
-                SEEL_Print::print(F("Parent: ")); // Parent
-                SEEL_Print::print(_inst->_parent_id);
-                SEEL_Print::print(F(", RSSI metric: ")); // RSSI
-                SEEL_Print::print(_inst->_path_rssi);
-                SEEL_Print::print(F(", Hop Count: "));
-                SEEL_Print::println(_inst->_cb_info.hop_count); // Hop Count
-            }
-
             // Only do the following tasks on the first parent connected
-            if(!_inst->_parent_sync)
+            if(!_parent_sync)
             {
                 // Save the previous here since sleep time may get changed in bcast_setup
-                uint32_t prev_sleep_time_secs = _inst->_snode_sleep_time_secs;
+                uint32_t prev_sleep_time_secs = _snode_sleep_time_secs;
                 
                 // bcast_setup may have already run from a blacklisted node, so check to
                 // make sure it only runs once
-                if(!_inst->_bcast_received)
+                if(!_bcast_received)
                 {
                     // bcast_setup returns true if the bcast is the first bcast from a GNODE (network restarted)
-                    _inst->bcast_setup(msg, receive_offset);
+                    bcast_setup(*msg, receive_offset);
                 }
                 
-                SEEL_Print::print(F("WTB: ")); SEEL_Print::println(_inst->_cb_info.wtb_millis);
+                if (SEEL_Print::enabled(SEEL_LOG_SLEEP, SEEL_LOG_LEVEL_INFO))
+                {
+                    SEEL_Print::print(F("WTB: ")); SEEL_Print::println(_cb_info.wtb_millis);
+                }
+
+                // Arrival is compared against the sleep before the WD estimate is updated below
+                if (SEEL_MAC::TIME_SLOTTED)
+                {
+                    // Bcasts carry a longer preamble with CAD, receive_offset is measured from the end of the packet
+                    wake_shift_update(rfm_rx_slot(receive_offset + SEEL_BCAST_EXTRA_TOA_MILLIS),
+                        _WD_adjusted && _system_sync && _cb_info.missed_bcasts == 0 && _last_parent == _parent_id);
+                }
 
                 // Adjusting sleep-time, only adjust if we already have wtb data
                 // Dont adjust sleep if previous bcast was missed, since we do not know how long we actually slept for;
                 // there is no bcast reference to measure against
                 // Make sure we have the same parent, otherwise WTB could be confounded by TDMA bcast delay
-                if(_inst->_system_sync && _inst->_cb_info.missed_bcasts == 0 && _inst->_last_parent == _inst->_parent_id)
+                if(_system_sync && _cb_info.missed_bcasts == 0 && _last_parent == _parent_id)
                 {
-                    SEEL_Assert::assert((uint64_t)(_inst->_snode_awake_time_secs + _inst->_snode_sleep_time_secs) * (uint64_t)SEEL_SECS_TO_MILLIS <= UINT32_MAX, SEEL_ASSERT_FILE_NUM_SNODE, __LINE__);
-                    uint32_t cycle_time_millis = (_inst->_snode_awake_time_secs + _inst->_snode_sleep_time_secs) * SEEL_SECS_TO_MILLIS;
+                    SEEL_Assert::assert((uint64_t)(_snode_awake_time_secs + _snode_sleep_time_secs) * (uint64_t)SEEL_SECS_TO_MILLIS <= UINT32_MAX, SEEL_ASSERT_FILE_NUM_SNODE, __LINE__);
+                    uint32_t cycle_time_millis = (_snode_awake_time_secs + _snode_sleep_time_secs) * SEEL_SECS_TO_MILLIS;
                     uint32_t prev_sleep_counts = 0;
                     uint32_t prev_sleep_time_millis = prev_sleep_time_secs * SEEL_SECS_TO_MILLIS;
+#if SEEL_EARLY_SLEEP_ENABLE
+                    prev_sleep_time_millis += _early_sleep_millis; // Previous sleep was extended by an early sleep
+#endif // SEEL_EARLY_SLEEP_ENABLE
                     SEEL_Assert::assert(prev_sleep_time_millis >= SEEL_ADJUSTED_SLEEP_EARLY_WAKE_MILLIS, SEEL_ASSERT_FILE_NUM_SNODE, __LINE__);
-                    if (prev_sleep_time_millis > (SEEL_ADJUSTED_SLEEP_EARLY_WAKE_MILLIS + _inst->_sleep_time_offset_millis))
+                    if (prev_sleep_time_millis > (SEEL_ADJUSTED_SLEEP_EARLY_WAKE_MILLIS + _sleep_time_offset_millis))
                     {
                         prev_sleep_counts = (prev_sleep_time_millis - SEEL_ADJUSTED_SLEEP_EARLY_WAKE_MILLIS - 
-                            _inst->_sleep_time_offset_millis) / _inst->_sleep_time_estimate_millis;
+                            _sleep_time_offset_millis) / _sleep_time_estimate_millis;
                     }
                     
                     // Trims WTB in case a bcast was missed. Later check if missed bcast was due to sleeping too long
-                    uint32_t wtb_trimmed_millis = _inst->_cb_info.wtb_millis % cycle_time_millis;
+                    uint32_t wtb_trimmed_millis = _cb_info.wtb_millis % cycle_time_millis;
                     uint32_t actual_sleep_time_millis = prev_sleep_time_millis - wtb_trimmed_millis;
                     
                     // SNODE woke up too late if trimmed WTB is longer than specified sleep time
@@ -332,159 +405,268 @@ void SEEL_SNode::SEEL_Task_SNode_Receive::run()
                         // Adjust the sleep time offset to prevent oversleeping again
                         SEEL_Assert::assert(cycle_time_millis >= wtb_trimmed_millis, SEEL_ASSERT_FILE_NUM_SNODE, __LINE__);
                         // Check we are not going negative with offset
-                        _inst->_sleep_time_offset_millis = min(cycle_time_millis - wtb_trimmed_millis, (prev_sleep_time_millis - SEEL_ADJUSTED_SLEEP_EARLY_WAKE_MILLIS));
-                        actual_sleep_time_millis = prev_sleep_time_millis + _inst->_sleep_time_offset_millis;
-                        SEEL_Print::print(F("New sleep offset: ")); SEEL_Print::println(_inst->_sleep_time_offset_millis);
+                        _sleep_time_offset_millis = min(cycle_time_millis - wtb_trimmed_millis, (prev_sleep_time_millis - SEEL_ADJUSTED_SLEEP_EARLY_WAKE_MILLIS));
+                        actual_sleep_time_millis = prev_sleep_time_millis + _sleep_time_offset_millis;
+                        if (SEEL_Print::enabled(SEEL_LOG_SLEEP, SEEL_LOG_LEVEL_DEBUG))
+                        {
+                            SEEL_Print::print(F("New sleep offset: ")); SEEL_Print::println(_sleep_time_offset_millis);
+                        }
                     }
-                    else if(_inst->_sleep_time_offset_millis > 0 && wtb_trimmed_millis > _inst->_sleep_time_offset_millis)
+                    else if(_sleep_time_offset_millis > 0 && wtb_trimmed_millis > _sleep_time_offset_millis)
                     {
-                        _inst->_sleep_time_offset_millis = 0;
-                        SEEL_Print::print(F("New sleep offset: ")); SEEL_Print::println(_inst->_sleep_time_offset_millis);
+                        _sleep_time_offset_millis = 0;
+                        if (SEEL_Print::enabled(SEEL_LOG_SLEEP, SEEL_LOG_LEVEL_DEBUG))
+                        {
+                            SEEL_Print::print(F("New sleep offset: ")); SEEL_Print::println(_sleep_time_offset_millis);
+                        }
                     }
 
-                    _inst->_sleep_time_estimate_millis = (prev_sleep_counts > 0) ? 
-                        actual_sleep_time_millis / prev_sleep_counts : _inst->_sleep_time_estimate_millis;
-                    SEEL_Print::print(F("Watchdog estimate: ")); SEEL_Print::println(_inst->_sleep_time_estimate_millis);
-                    _inst->_WD_adjusted = true;
+                    _sleep_time_estimate_millis = (prev_sleep_counts > 0) ? 
+                        actual_sleep_time_millis / prev_sleep_counts : _sleep_time_estimate_millis;
+                    if (SEEL_Print::enabled(SEEL_LOG_SLEEP, SEEL_LOG_LEVEL_DEBUG))
+                    {
+                        SEEL_Print::print(F("Watchdog estimate: ")); SEEL_Print::println(_sleep_time_estimate_millis);
+                    }
+                    _WD_adjusted = true;
                 }
-                else if(!_inst->_system_sync)// First configuration or GNODE was refreshed
+                else if(!_system_sync)// First configuration or GNODE was refreshed
                 {
                     // Keep the previous estimate of WD duration
-                    _inst->_sleep_time_offset_millis = 0;
+                    _sleep_time_offset_millis = 0;
                 }
 
-                bool prev_system_sync = _inst->_system_sync;
-                _inst->_parent_sync = true;
-                _inst->_system_sync = true; // resets on system restart
+                bool prev_system_sync = _system_sync;
+                _parent_sync = true;
+                _system_sync = true; // resets on system restart
                 
                 // Check if bcast msg just verified
                 // Ignore bcast msg if this was the first bcast msg received; any node ID msgs in bcast msg is not
                 // meant for this node
-                if(!_inst->_id_verified)
+                if(!_id_verified)
                 {
-                    _inst->_id_verified = (prev_system_sync && _inst->bcast_id_check(&msg));
+                    _id_verified = (prev_system_sync && bcast_id_check(msg));
                 }
 
-                bool added = _inst->_ref_scheduler->add_task(&_inst->_task_send); // Only start sending messages when broadcast is received and processed
-                SEEL_Assert::assert(added, SEEL_ASSERT_FILE_NUM_SNODE, __LINE__);
+                send_start(); // Only start sending messages when broadcast is received and processed
 
-                if (SEEL_PSEL_MODE == SEEL_PSEL_FIRST_BROADCAST)
+                bool added;
+                if (!SEEL_PSel::COLLECT)
                 {
-                    // If the Parent Selection mode is FIRST_BROADCAST then no broadcast collection delay is needed
-                    _inst->_parent_lock = true;
-                    added = _inst->_ref_scheduler->add_task(&_inst->_task_enqueue_msg);
+                    // If the Parent Selection policy does not collect bcasts then no broadcast collection delay is needed
+                    _parent_lock = true;
+                    _task_enqueue_msg.co_reset();
+                    added = _ref_scheduler->add_task(&_task_enqueue_msg);
                     SEEL_Assert::assert(added, SEEL_ASSERT_FILE_NUM_SNODE, __LINE__);
                 }
                 else
                 {
-                    added = _inst->_ref_scheduler->add_task(&_inst->_task_parent_lock, SEEL_PSEL_DURATION_MILLIS);
+                    added = _ref_scheduler->add_task(&_task_parent_lock, SEEL_PSEL_DURATION_MILLIS);
                     SEEL_Assert::assert(added, SEEL_ASSERT_FILE_NUM_SNODE, __LINE__);
                 }
             }
         }
-        else if(!_inst->_bcast_received) // Received bcast from blacklist node, but can still take time sync and sleep info
+        else if(!_bcast_received) // Received bcast from blacklist node, but can still take time sync and sleep info
         {
-            SEEL_Print::println(F("Blacklisted Node Bcast"));
+            if (SEEL_Print::enabled(SEEL_LOG_ROUTING, SEEL_LOG_LEVEL_DEBUG))
+            {
+                SEEL_Print::println(F("Blacklisted Node Bcast"));
+            }
             // Logic described above with the other call to bcast_setup
-            _inst->bcast_setup(msg, receive_offset);
+            bcast_setup(*msg, receive_offset);
         }
     } // End Bcast Msg block
-    else if(msg.cmd == SEEL_CMD_ACK && _inst->_unack_msgs > 0) // Only ack if ack is needed, acks have no target
+    else if(msg->cmd == SEEL_CMD_ACK && _unack_msgs > 0) // Only ack if ack is needed, acks have no target
     {
         // Check if ACK involves this node
         bool found = false;
         for (uint32_t i = 0; i < SEEL_MSG_DATA_SIZE && !found; ++i)
         {
-            found = (msg.data[i] == _inst->_node_id);
+            found = (msg->data[i] == _node_id);
         }
 
         if(found)
         {
             // Ack msg, decrement _data_queue_ptr
-            _inst->_data_queue_ptr->pop_front();
-            _inst->_msg_send_delay = 0;
-            _inst->_unack_msgs = 0;
-            --(_inst->_failed_transmissions);
-            _inst->_acked = true; // Gets set to true until cycle ends. This is to see if the parent ever ack'd messages. If not, add parent to blacklist.
+            _data_queue_ptr->pop_front();
+            _mac.on_ack();
+            _unack_msgs = 0;
+            --(_failed_transmissions);
+            _acked = true; // Gets set to true until cycle ends. This is to see if the parent ever ack'd messages. If not, add parent to blacklist.
 
-            SEEL_Print::println(F("ACK received"));
+            if (SEEL_Print::enabled(SEEL_LOG_RADIO, SEEL_LOG_LEVEL_INFO))
+            {
+                SEEL_Print::println(F("ACK received"));
+            }
         }
     }
-    else if(msg.targ_id == _inst->_node_id && (msg.cmd == SEEL_CMD_DATA || msg.cmd == SEEL_CMD_ID_CHECK)) // Other msg intended for this node must be from a child, forward msg
+    else if(msg->targ_id == _node_id && (msg->cmd == SEEL_CMD_DATA || msg->cmd == SEEL_CMD_ID_CHECK)) // Other msg intended for this node must be from a child, forward msg
     {
         // Node cannot be the recipient of another node
         // Continue to forward msg
-        if(_inst->enqueue_forwarding_msg(&msg))
+#if SEEL_RX_GATE_ENABLE
+        _rx_slot_mask |= (uint32_t) 1 << rfm_rx_slot(receive_offset);
+#endif // SEEL_RX_GATE_ENABLE
+        bool added = enqueue_forwarding_msg(msg);
+        if(added)
         {
             // Only acknowledge the msg if msg was added to the send queue (failure results if send queue is full)
-            _inst->enqueue_ack(&msg);
+            enqueue_ack(msg);
         }
+#if SEEL_EARLY_SLEEP_ENABLE
+        // A msg that is not ACK'd is sent again, so its sender is not done yet
+        child_heard(msg->send_id, added && rfm_receive_subtree_done());
+#endif // SEEL_EARLY_SLEEP_ENABLE
     }
-    else if(msg.targ_id == _inst->_node_id)// Illegal msg
+    else if(msg->targ_id == _node_id)// Illegal msg
     {
         // Should never be here
-        SEEL_Print::print(F("Error - Illegal Message")); // Error-Message
-        _inst->print_msg(&msg);
-        SEEL_Print::println(F(""));
-        _inst->set_flag(SEEL_Flags::FLAG_UNREC_MSG);
+        if (SEEL_Print::enabled(SEEL_LOG_RADIO, SEEL_LOG_LEVEL_ERROR))
+        {
+            SEEL_Print::print(F("Error - Illegal Message")); // Error-Message
+            print_msg(msg);
+            SEEL_Print::println(F(""));
+        }
+        set_flag(SEEL_Flags::FLAG_UNREC_MSG);
     }
     else
     {
-        SEEL_Print::println(F("Ignored message")); // Ignore this message
+        if (SEEL_Print::enabled(SEEL_LOG_RADIO, SEEL_LOG_LEVEL_DEBUG))
+        {
+            SEEL_Print::println(F("Ignored message")); // Ignore this message
+        }
     }
-
-    bool added = _inst->_ref_scheduler->add_task(&_inst->_task_receive);
-    SEEL_Assert::assert(added, SEEL_ASSERT_FILE_NUM_SNODE, __LINE__);
 }
 
 void SEEL_SNode::SEEL_Task_SNode_Parent_Lock::run()
 {
     _inst->_parent_lock = true;
+    _inst->send_ready(); // Queued data msgs may be sent now
+    _inst->_task_enqueue_msg.co_reset();
     bool added = _inst->_ref_scheduler->add_task(&_inst->_task_enqueue_msg);
     SEEL_Assert::assert(added, SEEL_ASSERT_FILE_NUM_SNODE, __LINE__);
 }
 
 void SEEL_SNode::SEEL_Task_SNode_Enqueue::run()
 {
-    if(_inst->_bcast_sent)
-    {
-        _inst->_cb_info.missed_msgs = _inst->_missed_msgs;
-        _inst->_missed_msgs = 0;
+    SEEL_CO_BEGIN();
 
-        if(_inst->_id_verified)
-        {
-            // Enable scheduling user tasks
-            _inst->_ref_scheduler->set_user_task_enable(true);
-            bool added = _inst->_ref_scheduler->add_task(&_inst->_task_user);
-            SEEL_Assert::assert(added, SEEL_ASSERT_FILE_NUM_SNODE, __LINE__);
-        }
-        else // Otherwise enqueue node id verification msg
-        {
-            _inst->enqueue_node_id();
-        }
+    // Wait until the bcast has been forwarded
+    SEEL_CO_AWAIT(_inst->_ref_scheduler, _inst->_bcast_sent, SEEL_SCHED_EVENT_BCAST_SENT);
+
+    _inst->_cb_info.missed_msgs = _inst->_missed_msgs;
+    _inst->_missed_msgs = 0;
+
+#if SEEL_EARLY_SLEEP_ENABLE
+    {
+        // Children can only send once they received the forwarded bcast
+        _inst->_bcast_sent_millis = millis();
+        _inst->_early_sleep_armed = true;
+        bool added = _inst->_ref_scheduler->add_periodic_task(&_inst->_task_early_sleep, SEEL_TDMA_SLOT_WAIT_MILLIS);
+        SEEL_Assert::assert(added, SEEL_ASSERT_FILE_NUM_SNODE, __LINE__);
     }
-    else
+#endif // SEEL_EARLY_SLEEP_ENABLE
+#if SEEL_RX_GATE_ENABLE
     {
-        bool added = _inst->_ref_scheduler->add_task(&_inst->_task_enqueue_msg);
+        // Receive stays continuous while children join and their slots are learned
+        bool added = _inst->_ref_scheduler->add_task(&_inst->_task_rx_gate, SEEL_RX_GATE_LEARN_CYCLES * SEEL_TDMA_CYCLE_TIME_MILLIS);
         SEEL_Assert::assert(added, SEEL_ASSERT_FILE_NUM_SNODE, __LINE__);
     }
+#endif // SEEL_RX_GATE_ENABLE
+
+    if(_inst->_id_verified)
+    {
+        // Enable scheduling user tasks
+        _inst->_ref_scheduler->set_user_task_enable(true);
+        _inst->_task_user.co_reset();
+        bool added = _inst->_ref_scheduler->add_task(&_inst->_task_user);
+        SEEL_Assert::assert(added, SEEL_ASSERT_FILE_NUM_SNODE, __LINE__);
+    }
+    else // Otherwise enqueue node id verification msg
+    {
+        _inst->enqueue_node_id();
+    }
+
+    SEEL_CO_END();
 }
 
 
 void SEEL_SNode::SEEL_Task_SNode_User::run()
 {
-    // Make sure we receive bcast_msg before enqueuing user msgs
-    if(_inst->_bcast_received)
+    SEEL_CO_BEGIN();
+
+    // Polls the user load callback until the scheduler is cleared
+    while (true)
     {
-        _inst->enqueue_data();
+        // Make sure we receive bcast_msg before enqueuing user msgs
+        if(_inst->_bcast_received)
+        {
+            _inst->enqueue_data();
+        }
+        SEEL_CO_AWAIT_DELAY(_inst->_ref_scheduler, SEEL_SNODE_USER_POLL_MILLIS);
     }
 
-    bool added = _inst->_ref_scheduler->add_task(&_inst->_task_user);
-    SEEL_Assert::assert(added, SEEL_ASSERT_FILE_NUM_SNODE, __LINE__);
+    SEEL_CO_END();
+}
+
+#if SEEL_CAD_ENABLE
+void SEEL_SNode::SEEL_Task_SNode_Cad::run()
+{
+    SEEL_CO_BEGIN();
+
+    while (!_inst->_bcast_received && _inst->_cad_false_detects < SEEL_CAD_FALSE_DETECT_LIMIT)
+    {
+        _inst->rfm_cad_start();
+        SEEL_CO_AWAIT(_inst->_ref_scheduler, _inst->_cad_done, SEEL_SCHED_EVENT_CAD_DONE);
+
+        if (_inst->_cad_detected)
+        {
+            // Transceiver is receiving, give the packet time to arrive
+            SEEL_CO_AWAIT_DELAY(_inst->_ref_scheduler, SEEL_CAD_RX_HOLD_MILLIS);
+            if (!_inst->_bcast_received)
+            {
+                ++_inst->_cad_false_detects;
+            }
+        }
+        else
+        {
+            SEEL_CO_AWAIT_DELAY(_inst->_ref_scheduler, SEEL_CAD_PERIOD_MILLIS);
+        }
+    }
+
+    // The bcast is forwarded right after it is received, receive mode must not cut that transmission off
+    if (!_inst->_bcast_received)
+    {
+        if (SEEL_Print::enabled(SEEL_LOG_RADIO, SEEL_LOG_LEVEL_ERROR))
+        {
+            SEEL_Print::println(F("CAD off"));
+        }
+        _inst->_LoRaPHY_ptr->receive();
+    }
+
+    SEEL_CO_END();
 }
+#endif // SEEL_CAD_ENABLE
 
 void SEEL_SNode::SEEL_Task_SNode_Sleep::run()
 {
+    // Let an in-progress transmission finish (and be counted) before putting the transceiver to sleep
+    // Re-armed with a delay, a critical task re-armed at "now" would keep the receive ring from being drained
+    if (_inst->rfm_tx_busy())
+    {
+        _inst->_ref_scheduler->rearm_current_task(_inst->rfm_tx_remaining_millis());
+        return;
+    }
+
+#if SEEL_EARLY_SLEEP_ENABLE
+    // Awake time left if the sleep task was moved up, sleep() adds it to the sleep time
+    uint32_t now_millis = millis();
+    _inst->_early_sleep_millis = 0;
+    if (_inst->_bcast_received && (int32_t) (_inst->_sleep_due_millis - now_millis) > 0)
+    {
+        _inst->_early_sleep_millis = _inst->_sleep_due_millis - now_millis;
+    }
+#endif // SEEL_EARLY_SLEEP_ENABLE
+
     // Store any info messages
     _inst->_cb_info.prev_CRC_fails = _inst->_CRC_fails;
     _inst->_cb_info.prev_max_data_queue_size = _inst->_max_data_queue_size;
@@ -498,6 +680,10 @@ void SEEL_SNode::SEEL_Task_SNode_Sleep::run()
     _inst->_cb_info.prev_queue_dropped_msgs_self = _inst->_queue_dropped_msgs_self;
     _inst->_cb_info.prev_queue_dropped_msgs_others = _inst->_queue_dropped_msgs_others;
     _inst->_cb_info.prev_failed_transmissions = _inst->_failed_transmissions;
+#if SEEL_SCHED_STATS_ENABLE
+    _inst->_cb_info.prev_sched_summary = _inst->_ref_scheduler->get_stats_summary();
+    _inst->_ref_scheduler->print_stats();
+#endif // SEEL_SCHED_STATS_ENABLE
 
     // If we are non-force sleeping and parent_sync is false, then we must have received a bcast from a blacklisted parent
     // and not one from a non-blacklisted parent; thus, we did not generate data this cycle
@@ -507,16 +693,19 @@ void SEEL_SNode::SEEL_Task_SNode_Sleep::run()
     }
 
     // A parent was selected and a (ack-needed) msg was sent to parent, but parent never responded back
-    if(_inst->_parent_sync && !_inst->_acked && _inst->_cycle_transmissions.data > 0) 
+    if(_inst->_parent_sync && !_inst->_acked && _inst->_cycle_transmissions.get_acked_trans() > 0)
     {
         // Blacklist the parent
-        SEEL_Print::print(F("Blacklisted NODE: ")); SEEL_Print::println(_inst->_parent_id); // Blacklist: parent ID
+        if (SEEL_Print::enabled(SEEL_LOG_ROUTING, SEEL_LOG_LEVEL_INFO))
+        {
+            SEEL_Print::print(F("Blacklisted NODE: ")); SEEL_Print::println(_inst->_parent_id); // Blacklist: parent ID
+        }
         _inst->_bcast_blacklist.add(_inst->_parent_id, true);
         _inst->_acked = true;
     }
 
-    // Clear any remaining tasks and prepare for wakeup
-    _inst->_ref_scheduler->clear_tasks();
+    // Clear remaining SEEL tasks and prepare for wakeup, user schedules are kept across cycles
+    _inst->_ref_scheduler->clear_tasks(false);
 
     // Add in wakeup now
     bool added = _inst->_ref_scheduler->add_task(&_inst->_task_wake);
@@ -531,22 +720,126 @@ void SEEL_SNode::SEEL_Task_SNode_Sleep::run()
 
 void SEEL_SNode::SEEL_Task_SNode_Force_Sleep::run()
 {
-    // If bcast received, then no need to force sleep
-    if(_inst->_bcast_received)
+    // Cancelled once a bcast is received
+    if (SEEL_Print::enabled(SEEL_LOG_SLEEP, SEEL_LOG_LEVEL_INFO))
     {
-        return;
+        SEEL_Print::println(F("Force Sleep, clearing blacklist"));
     }
-
-    SEEL_Print::println(F("Force Sleep, clearing blacklist"));
     ++_inst->_missed_bcasts;
     ++_inst->_missed_msgs;
     _inst->_bcast_blacklist.clear();
     // Force sleep is necessary, run regular sleep function
-    _inst->_ref_scheduler->clear_tasks(); // Guarentee sleep to be next task
+    _inst->_ref_scheduler->clear_tasks(false); // Guarentee sleep to be next task (user tasks are deferred behind critical sleep)
     bool added = _inst->_ref_scheduler->add_task(&_inst->_task_sleep);
     SEEL_Assert::assert(added, SEEL_ASSERT_FILE_NUM_SNODE, __LINE__);
 }
 
+#if SEEL_EARLY_SLEEP_ENABLE
+void SEEL_SNode::SEEL_Task_SNode_Early_Sleep::run()
+{
+    if (!_inst->early_sleep_ready())
+    {
+        return;
+    }
+
+    if (SEEL_Print::enabled(SEEL_LOG_SLEEP, SEEL_LOG_LEVEL_INFO))
+    {
+        SEEL_Print::print(F("Early sleep, awake millis skipped: ")); SEEL_Print::println(_inst->_sleep_due_millis - millis());
+    }
+    _inst->_ref_scheduler->stop_current_task();
+    bool rescheduled = _inst->_ref_scheduler->reschedule_task(_inst->_sleep_handle, 0);
+    SEEL_Assert::assert(rescheduled, SEEL_ASSERT_FILE_NUM_SNODE, __LINE__);
+}
+
+void SEEL_SNode::child_heard(uint8_t child_id, bool done)
+{
+    SEEL_Child* child = NULL;
+    for (uint8_t i = 0; i < _child_count && child == NULL; ++i)
+    {
+        if (_children[i].id == child_id)
+        {
+            child = &_children[i];
+        }
+    }
+
+    if (child == NULL)
+    {
+        if (_child_count >= SEEL_EARLY_SLEEP_MAX_CHILDREN)
+        {
+            _children_overflow = true; // Untracked child, cannot tell when it is done
+            return;
+        }
+        child = &_children[_child_count++];
+        child->id = child_id;
+    }
+
+    child->last_heard_millis = millis();
+    child->missed_cycles = 0;
+    child->heard = true;
+    child->done = done;
+}
+
+void SEEL_SNode::children_new_cycle()
+{
+    uint8_t kept = 0;
+    for (uint8_t i = 0; i < _child_count; ++i)
+    {
+        SEEL_Child child = _children[i];
+        if (!child.heard && ++child.missed_cycles >= SEEL_EARLY_SLEEP_CHILD_EXPIRE_CYCLES)
+        {
+            continue; // Child moved to another parent or left the network
+        }
+        child.heard = false;
+        child.done = false;
+        _children[kept++] = child;
+    }
+    _child_count = kept;
+    _children_overflow = false;
+}
+
+bool SEEL_SNode::children_done(uint32_t now_millis)
+{
+    if (_children_overflow)
+    {
+        return false;
+    }
+
+    for (uint8_t i = 0; i < _child_count; ++i)
+    {
+        const SEEL_Child& child = _children[i];
+        uint32_t silent_millis = now_millis - (child.heard ? child.last_heard_millis : _bcast_sent_millis);
+        // A done child may still resend its last msg in its next slot if the ACK was lost
+        uint32_t required_millis = child.done ? (SEEL_TDMA_CYCLE_TIME_MILLIS + SEEL_TDMA_SLOT_WAIT_MILLIS) :
+            (SEEL_EARLY_SLEEP_SILENT_CYCLES * SEEL_TDMA_CYCLE_TIME_MILLIS);
+        if (silent_millis < required_millis)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool SEEL_SNode::early_sleep_ready()
+{
+    uint32_t now_millis = millis();
+
+    // Stay awake long enough for new children to join through this NODE
+    if (now_millis - _bcast_sent_millis < SEEL_EARLY_SLEEP_SILENT_CYCLES * SEEL_TDMA_CYCLE_TIME_MILLIS)
+    {
+        return false;
+    }
+
+    return own_load_done() && _data_queue_ptr->empty() && _ack_queue.empty() && _unack_msgs == 0 &&
+        !rfm_tx_busy() && children_done(now_millis);
+}
+
+bool SEEL_SNode::subtree_done_hint()
+{
+    // The msg about to be sent is the last one, unless children or the user still add msgs
+    return _early_sleep_armed && own_load_done() && _data_queue_ptr->size() <= 1 && children_done(millis());
+}
+#endif // SEEL_EARLY_SLEEP_ENABLE
+
 bool SEEL_SNode::bcast_id_check(SEEL_Message* msg)
 {
     // Check if Gnode has okay'd this node's ID
@@ -579,7 +872,10 @@ bool SEEL_SNode::bcast_id_check(SEEL_Message* msg)
         {
             // Safety check, error can occur when snode and gnode are not updated at the same time and
             // snode has more user slots than gnode. Leads to array access in unallocated memory.
-            SEEL_Print::println(F("Error - Slot Mismatch")); // Error - Slot mismatch
+            if (SEEL_Print::enabled(SEEL_LOG_ROUTING, SEEL_LOG_LEVEL_ERROR))
+            {
+                SEEL_Print::println(F("Error - Slot Mismatch")); // Error - Slot mismatch
+            }
             SEEL_Assert::assert(false, SEEL_ASSERT_FILE_NUM_SNODE, __LINE__);
             break;
         }
@@ -614,70 +910,88 @@ bool SEEL_SNode::bcast_id_check(SEEL_Message* msg)
 bool SEEL_SNode::enqueue_forwarding_msg(SEEL_Message* prev_msg)
 {
 
-    bool added = false;
     // We know ID/Data msgs ultimately end up at the Gnode, so we can use relative sender and target id's
-    // to faciliate acknowledgements and message travel. To send original sender ID, use data section 
-    uint32_t original_target = prev_msg->targ_id;
-    uint32_t original_sender = prev_msg->send_id;
-    prev_msg->targ_id = _parent_id;
-    prev_msg->send_id = _node_id;
+    // to faciliate acknowledgements and message travel. Sender and target are set to this node and its parent
+    // at send time, the original sender ID stays in orig_send_id
     bool forward_msg = true;
     if(prev_msg->cmd == SEEL_CMD_DATA && _user_cb_forwarding != NULL)
     {
         forward_msg = _user_cb_forwarding(prev_msg->data, &_cb_info); // May modify "prev_msg->data"
     }
 
-    if (forward_msg)
+    // The received msg is queued in place, taken out of the receive ring rather than copied
+    SEEL_Msg_Class msg_class = (prev_msg->cmd == SEEL_CMD_ID_CHECK) ? MSG_CLASS_CONTROL : MSG_CLASS_FWD;
+    SEEL_Msg_Class evicted = MSG_CLASS_NONE;
+    SEEL_Msg_Handle handle = SEEL_MSG_NO_HANDLE;
+    if (forward_msg && _data_queue_ptr->make_room(msg_class, prev_msg->send_id, &evicted))
     {
-        added = _data_queue_ptr->add(*prev_msg);
+        handle = rfm_receive_adopt();
     }
-
-    prev_msg->targ_id = original_target;
-    prev_msg->send_id = original_sender;
+    bool added = _data_queue_ptr->add(handle, msg_class, prev_msg->send_id, false);
+    _msg_pool_ptr->release(added ? SEEL_MSG_NO_HANDLE : handle);
 
     if (added) {
-        SEEL_Print::print(F("Enqueue forwarding message: "));
-        _data_queue_ptr->print();
+        send_ready();
+        if (SEEL_Print::enabled(SEEL_LOG_QUEUE, SEEL_LOG_LEVEL_DEBUG))
+        {
+            SEEL_Print::print(F("Enqueue forwarding message: "));
+            _data_queue_ptr->print();
+        }
         if (_data_queue_ptr->size() > _max_data_queue_size) {
              _max_data_queue_size = _data_queue_ptr->size();
         }
     }
     else {
-        SEEL_Print::println(F("Forwarding message not added"));
-        _queue_dropped_msgs_others += 1;
-        SEEL_Node::set_flag(SEEL_Flags::FLAG_ADD_MAX_DATA_QUEUE);
+        if (SEEL_Print::enabled(SEEL_LOG_QUEUE, SEEL_LOG_LEVEL_ERROR))
+        {
+            SEEL_Print::println(F("Forwarding message not added"));
+        }
+        count_queue_drop(MSG_CLASS_FWD);
     }
+    count_queue_drop(evicted);
     return added;
 }
 
 bool SEEL_SNode::enqueue_node_id()
 {
-    SEEL_Message msg;
     uint8_t msg_data[SEEL_MSG_DATA_SIZE];
     memset(msg_data, 0, sizeof(msg_data[0]) * SEEL_MSG_DATA_SIZE);
     
     // Protocol: When verifying node id's, the node id is placed
     // in the first element of the data slot so the Gnode should check this slot for ID addition
-    msg_data[SEEL_MSG_DATA_ID_CHECK_INDEX] = _node_id;
-    msg_data[SEEL_MSG_DATA_ID_ENCRYPT_INDEX] = (uint8_t) (_unique_key >> 24);
-    msg_data[SEEL_MSG_DATA_ID_ENCRYPT_INDEX + 1] = (uint8_t) (_unique_key >> 16);
-    msg_data[SEEL_MSG_DATA_ID_ENCRYPT_INDEX + 2] = (uint8_t) (_unique_key >> 8);
-    msg_data[SEEL_MSG_DATA_ID_ENCRYPT_INDEX + 3] = (uint8_t) (_unique_key);
+    SEEL_Wire_ID_Check::ID::set(msg_data, _node_id);
+    SEEL_Wire_ID_Check::Unique_Key::set(msg_data, _unique_key);
     
-    create_msg(&msg, _parent_id, SEEL_CMD_ID_CHECK, msg_data);
-    bool added = _data_queue_ptr->add(msg);
+    SEEL_Msg_Class evicted;
+    SEEL_Msg_Handle handle = SEEL_MSG_NO_HANDLE;
+    if (_data_queue_ptr->make_room(MSG_CLASS_CONTROL, _node_id, &evicted))
+    {
+        handle = _msg_pool_ptr->alloc();
+    }
+    if (handle != SEEL_MSG_NO_HANDLE)
+    {
+        create_msg(_msg_pool_ptr->get(handle), _parent_id, SEEL_CMD_ID_CHECK, msg_data);
+    }
+    count_queue_drop(evicted);
+    bool added = _data_queue_ptr->add(handle, MSG_CLASS_CONTROL, _node_id, true);
 
     if (added) {
-        SEEL_Print::print(F("Enqueue ID message: "));
-        _data_queue_ptr->print();
+        send_ready();
+        if (SEEL_Print::enabled(SEEL_LOG_QUEUE, SEEL_LOG_LEVEL_DEBUG))
+        {
+            SEEL_Print::print(F("Enqueue ID message: "));
+            _data_queue_ptr->print();
+        }
         if (_data_queue_ptr->size() > _max_data_queue_size) {
             _max_data_queue_size = _data_queue_ptr->size();
         }
     }
     else {
-        SEEL_Print::println(F("ID message not added"));
-        _queue_dropped_msgs_self += 1;
-        SEEL_Node::set_flag(SEEL_Flags::FLAG_ADD_MAX_DATA_QUEUE);
+        if (SEEL_Print::enabled(SEEL_LOG_QUEUE, SEEL_LOG_LEVEL_ERROR))
+        {
+            SEEL_Print::println(F("ID message not added"));
+        }
+        count_queue_drop(MSG_CLASS_CONTROL);
     }
 
 
@@ -687,7 +1001,6 @@ bool SEEL_SNode::enqueue_node_id()
 bool SEEL_SNode::enqueue_data()
 {
 
-    SEEL_Message msg;
     uint8_t msg_data[SEEL_MSG_DATA_SIZE];
     
     // _id_verified:
@@ -708,19 +1021,35 @@ bool SEEL_SNode::enqueue_data()
 
         if(enqueue_user_message)
         {
-            create_msg(&msg, _parent_id, SEEL_CMD_DATA, msg_data);
-            bool added = _data_queue_ptr->add(msg);
+            SEEL_Msg_Class evicted;
+            SEEL_Msg_Handle handle = SEEL_MSG_NO_HANDLE;
+            if (_data_queue_ptr->make_room(MSG_CLASS_OWN, _node_id, &evicted))
+            {
+                handle = _msg_pool_ptr->alloc();
+            }
+            if (handle != SEEL_MSG_NO_HANDLE)
+            {
+                create_msg(_msg_pool_ptr->get(handle), _parent_id, SEEL_CMD_DATA, msg_data);
+            }
+            count_queue_drop(evicted);
+            bool added = _data_queue_ptr->add(handle, MSG_CLASS_OWN, _node_id, true);
             if (added) {
-                SEEL_Print::print(F("Enqueue data message: "));
-                _data_queue_ptr->print();
+                send_ready();
+                if (SEEL_Print::enabled(SEEL_LOG_QUEUE, SEEL_LOG_LEVEL_DEBUG))
+                {
+                    SEEL_Print::print(F("Enqueue data message: "));
+                    _data_queue_ptr->print();
+                }
                 if (_data_queue_ptr->size() > _max_data_queue_size) {
                     _max_data_queue_size = _data_queue_ptr->size();
                 }
             }
             else {
-                SEEL_Print::println(F("Data message not added"));
-                _queue_dropped_msgs_self += 1;
-                SEEL_Node::set_flag(SEEL_Flags::FLAG_ADD_MAX_DATA_QUEUE);
+                if (SEEL_Print::enabled(SEEL_LOG_QUEUE, SEEL_LOG_LEVEL_ERROR))
+                {
+                    SEEL_Print::println(F("Data message not added"));
+                }
+                count_queue_drop(MSG_CLASS_OWN);
             }
             
             return added;
@@ -730,6 +1059,57 @@ bool SEEL_SNode::enqueue_data()
     return false; // No message to be added
 }
 
+void SEEL_SNode::wake_shift_update(uint8_t bcast_slot, bool measured)
+{
+    // Without a measurement, every hop above this SNODE (the parent's hop count) may forward a TDMA cycle earlier
+    uint8_t max_shift_hops = _cb_info.hop_count - 1;
+    if (!measured || bcast_slot != _bcast_slot)
+    {
+        _wake_shift_hops = max_shift_hops;
+    }
+    else
+    {
+        // The parent keeps its slot, so the bcast arrives a whole number of TDMA cycles off the expected time
+        uint32_t cycle_time_millis = (_snode_awake_time_secs + _snode_sleep_time_secs) * SEEL_SECS_TO_MILLIS;
+        uint32_t wtb_trimmed_millis = _cb_info.wtb_millis % cycle_time_millis;
+        uint32_t early_millis = (_expected_wtb_millis > wtb_trimmed_millis) ? _expected_wtb_millis - wtb_trimmed_millis : 0;
+        uint32_t shift_cycles = (early_millis + SEEL_TDMA_CYCLE_TIME_MILLIS / 2) / SEEL_TDMA_CYCLE_TIME_MILLIS;
+        if (shift_cycles == 0)
+        {
+            // Bcast on time, trust the upstream timing one hop more
+            _wake_shift_hops = (_wake_shift_hops > 0) ? _wake_shift_hops - 1 : 0;
+        }
+        else
+        {
+            _wake_shift_hops = min(max((uint32_t) _wake_shift_hops, shift_cycles), (uint32_t) max_shift_hops);
+        }
+    }
+    _bcast_slot = bcast_slot;
+
+    if (SEEL_Print::enabled(SEEL_LOG_SLEEP, SEEL_LOG_LEVEL_DEBUG))
+    {
+        SEEL_Print::print(F("Bcast slot: ")); SEEL_Print::print(_bcast_slot);
+        SEEL_Print::print(F(", Wake shift hops: ")); SEEL_Print::println(_wake_shift_hops);
+    }
+}
+
+void SEEL_SNode::count_queue_drop(SEEL_Msg_Class msg_class)
+{
+    if (msg_class == MSG_CLASS_NONE)
+    {
+        return;
+    }
+    if (msg_class == MSG_CLASS_FWD)
+    {
+        _queue_dropped_msgs_others += 1;
+    }
+    else
+    {
+        _queue_dropped_msgs_self += 1;
+    }
+    SEEL_Node::set_flag(SEEL_Flags::FLAG_ADD_MAX_DATA_QUEUE);
+}
+
 void SEEL_SNode::sleep()
 {
     // Puts Arduino into low power state
@@ -737,39 +1117,50 @@ void SEEL_SNode::sleep()
     // period the watchdog time can sleep for
     uint32_t sleep_counts = 0;
     uint32_t snode_sleep_time_millis = _snode_sleep_time_secs * SEEL_SECS_TO_MILLIS;
+#if SEEL_EARLY_SLEEP_ENABLE
+    snode_sleep_time_millis += _early_sleep_millis; // Wake up at the same time as without early sleep
+#endif // SEEL_EARLY_SLEEP_ENABLE
     uint32_t early_wakeup_time = SEEL_ADJUSTED_SLEEP_EARLY_WAKE_MILLIS + _sleep_time_offset_millis;
-    // TODO: Make similar case for EB algorithm
-    if (SEEL_TDMA_USE_TDMA)
-    {
-        // Need to wake up earlier if we received bcast later
-        // To be safe, need to wake up parent hop count times TDMA cycle time millis earlier
-        // Imagine worst case when parent takes entire TDMA cycle to broadcast
-        // Since (updated) parent must have smaller hop count than current node, this logic works for parent updates too
-        early_wakeup_time = max(early_wakeup_time, SEEL_TDMA_CYCLE_TIME_MILLIS * (_cb_info.hop_count - 1)); // Parent hop count is ours minus 1
-    }
+    // The bcast is expected one cycle after the previous one; wake up earlier only for the hops above that may
+    // forward it earlier, see wake_shift_update(). Deep SNODEs with stable upstream timing wake like their parents
+    early_wakeup_time = max(early_wakeup_time, SEEL_MAC::wake_guard_millis(_wake_shift_hops));
     if(_missed_bcasts > 0)
     {
         // Make signed int since awake duration could be smaller than specified, then sleep longer
-        SEEL_Assert::assert((((uint64_t)SEEL_FORCE_SLEEP_AWAKE_MULT * 
-            pow(SEEL_FORCE_SLEEP_AWAKE_DURATION_SCALE, _missed_bcasts) - 1) * 
-            _snode_awake_time_secs * SEEL_SECS_TO_MILLIS) <= INT32_MAX, SEEL_ASSERT_FILE_NUM_SNODE, __LINE__);
-        int32_t extra_awake_time_millis = (SEEL_FORCE_SLEEP_AWAKE_MULT * 
-            pow(SEEL_FORCE_SLEEP_AWAKE_DURATION_SCALE, _missed_bcasts) - 1) * 
-            _snode_awake_time_secs * SEEL_SECS_TO_MILLIS;
+        // extra = (awake scale - 1) * awake time, computed on magnitudes and truncated toward zero
+        uint32_t awake_time_millis = _snode_awake_time_secs * SEEL_SECS_TO_MILLIS;
+        SEEL_Q16 awake_scale = SEEL_Fixed::mul(SEEL_FORCE_SLEEP_AWAKE_MULT_Q16,
+            SEEL_Fixed::pow(SEEL_FORCE_SLEEP_AWAKE_DURATION_SCALE_Q16, _missed_bcasts));
+        bool shorter = awake_scale < SEEL_Q16_ONE;
+        uint64_t extra_magnitude = SEEL_Fixed::scale(awake_time_millis,
+            shorter ? (SEEL_Q16_ONE - awake_scale) : (awake_scale - SEEL_Q16_ONE));
+        SEEL_Assert::assert(extra_magnitude <= INT32_MAX, SEEL_ASSERT_FILE_NUM_SNODE, __LINE__);
+        int32_t extra_awake_time_millis = shorter ? -(int32_t) extra_magnitude : (int32_t) extra_magnitude;
         early_wakeup_time += extra_awake_time_millis;
     }
-    SEEL_Print::print(F("Extra wakeup time (millis): ")); SEEL_Print::println(early_wakeup_time);
+    if (SEEL_Print::enabled(SEEL_LOG_SLEEP, SEEL_LOG_LEVEL_DEBUG))
+    {
+        SEEL_Print::print(F("Extra wakeup time (millis): ")); SEEL_Print::println(early_wakeup_time);
+    }
     SEEL_Assert::assert(snode_sleep_time_millis >= early_wakeup_time, SEEL_ASSERT_FILE_NUM_SNODE, __LINE__);
     if(snode_sleep_time_millis > early_wakeup_time)
     {
         sleep_counts = (snode_sleep_time_millis - early_wakeup_time) / _sleep_time_estimate_millis;
     }
     // Else, sleep counts stay at 0
+    _expected_wtb_millis = snode_sleep_time_millis - sleep_counts * _sleep_time_estimate_millis;
 
-    SEEL_Print::print(F("Sleeping for ")); SEEL_Print::print(sleep_counts); SEEL_Print::println(F(" counts"));
-    SEEL_Print::flush();
+    if (SEEL_Print::enabled(SEEL_LOG_SLEEP, SEEL_LOG_LEVEL_INFO))
+    {
+        SEEL_Print::print(F("Sleeping for ")); SEEL_Print::print(sleep_counts); SEEL_Print::println(F(" counts"));
+        SEEL_Print::flush();
+    }
+    SEEL_Print::drain(true); // Deferred log output would otherwise wait out the sleep
     for (uint32_t i = 0; i < sleep_counts; ++i)
     {
         LowPower.powerDown(SEEL_WD_TIMER_DUR, ADC_OFF, BOD_OFF);
     }
+
+    // millis() stops during power down, keep tasks kept across the sleep on schedule
+    _ref_scheduler->add_sleep_time(sleep_counts * _sleep_time_estimate_millis);
 }
\ No newline at end of file
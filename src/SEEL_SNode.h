@@ -24,6 +24,10 @@ public:
     
     // ***************************************************
     // Member functions
+
+    // Constructor
+    SEEL_SNode() : _snode_data_queue(&_snode_msg_pool) {}
+
     void init(  SEEL_Scheduler* ref_scheduler,
                 user_callback_load_t user_cb_load, 
                 user_callback_presend_t user_cb_presend,
@@ -36,11 +40,24 @@ public:
         _bcast_blacklist.add(node_id);
     }
 private:
+    // Structs & Classes
+#if SEEL_EARLY_SLEEP_ENABLE
+    // Child NODE learned from forwarded msgs, see SEEL_EARLY_SLEEP_ENABLE
+    struct SEEL_Child
+    {
+        uint32_t last_heard_millis; // millis() of the last msg received this cycle
+        uint8_t id;
+        uint8_t missed_cycles; // Cycles in a row without a msg
+        bool heard; // A msg was received this cycle
+        bool done; // The last msg received this cycle flagged the child's subtree done
+    };
+#endif // SEEL_EARLY_SLEEP_ENABLE
+
     // Tasks
     class SEEL_Task_SNode : public SEEL_Task
     {
     public:
-        void set_inst(SEEL_SNode* inst) {_inst = inst; _user_task = false;}
+        void set_inst(SEEL_SNode* inst, SEEL_Task_Priority priority = PRIORITY_SYSTEM) {_inst = inst; _priority = priority;}
     protected:
         SEEL_Task_SNode() {} // Prevents class instantiation
         SEEL_SNode* _inst;
@@ -52,7 +69,7 @@ private:
     class SEEL_Task_SNode_Wake : public SEEL_Task_SNode {virtual void run();};
     SEEL_Task_SNode_Wake _task_wake;
 
-    // Checks for LoRa messages and handles appropriately. Receives broadcast.
+    // Handles LoRa messages captured by the receive ISR, runs when SEEL_SCHED_EVENT_RX is raised. Receives broadcast.
     class SEEL_Task_SNode_Receive : public SEEL_Task_SNode {virtual void run();};
     SEEL_Task_SNode_Receive _task_receive;
 
@@ -77,6 +94,19 @@ private:
     class SEEL_Task_SNode_Force_Sleep : public SEEL_Task_SNode {virtual void run();};
     SEEL_Task_SNode_Force_Sleep _task_force_sleep;
 
+#if SEEL_EARLY_SLEEP_ENABLE
+    // Runs once per TDMA slot after the bcast is forwarded, moves the sleep task up once the subtree is done
+    class SEEL_Task_SNode_Early_Sleep : public SEEL_Task_SNode {virtual void run();};
+    SEEL_Task_SNode_Early_Sleep _task_early_sleep;
+#endif // SEEL_EARLY_SLEEP_ENABLE
+
+#if SEEL_CAD_ENABLE
+    // Samples the channel with CAD until the bcast is received, the transceiver sleeps in between
+    // Falls back to continuous receive after SEEL_CAD_FALSE_DETECT_LIMIT detections without a bcast
+    class SEEL_Task_SNode_Cad : public SEEL_Task_SNode {virtual void run();};
+    SEEL_Task_SNode_Cad _task_cad;
+#endif // SEEL_CAD_ENABLE
+
     // ***************************************************
     // Member functions
 
@@ -87,6 +117,16 @@ private:
 
     bool bcast_id_check(SEEL_Message* msg);
 
+    // Updates _wake_shift_hops from the first parent bcast of the cycle, received in TDMA "bcast_slot"
+    // "measured" is true if the bcast came from the same parent as last cycle after a timed (WD adjusted) sleep
+    void wake_shift_update(uint8_t bcast_slot, bool measured);
+
+    // Receive ISR header filter, see SEEL_Node.h
+    virtual bool rfm_header_accept(const SEEL_Message* header);
+
+    // Handles a single valid msg taken from the receive ring
+    void handle_msg(SEEL_Message* msg, int8_t msg_rssi, uint32_t receive_offset);
+
     void sleep();
 
     // Enqueue messages: These are messages that can be sent with delay and need to be ack'd 
@@ -96,21 +136,61 @@ private:
     bool enqueue_node_id();
 
     bool enqueue_data();
+
+    // Counts a msg of "msg_class" dropped from or rejected by the data queue, MSG_CLASS_NONE is ignored
+    void count_queue_drop(SEEL_Msg_Class msg_class);
+
+#if SEEL_EARLY_SLEEP_ENABLE
+    // Records a msg from child "child_id"; "done" if the msg was accepted and flagged the child's subtree done
+    void child_heard(uint8_t child_id, bool done);
+
+    // Starts tracking a new cycle, forgets children missing for SEEL_EARLY_SLEEP_CHILD_EXPIRE_CYCLES
+    void children_new_cycle();
+
+    // Returns true if every known child flagged its subtree done or has been silent long enough
+    bool children_done(uint32_t now_millis);
+
+    // Returns true if this NODE will not load more msgs of its own this cycle
+    bool own_load_done() {return !_id_verified || !_cb_info.first_callback;}
+
+    // Returns true if this NODE and its subtree have nothing left to send or forward this cycle
+    bool early_sleep_ready();
+
+    virtual bool subtree_done_hint();
+#endif // SEEL_EARLY_SLEEP_ENABLE
     
     // ***************************************************
     // Member variables
-    SEEL_SNode_Msg_Queue<SEEL_Message> _snode_data_queue;
+    SEEL_Msg_Pool_Storage<SEEL_SNODE_MSG_POOL_SIZE> _snode_msg_pool;
+    SEEL_Data_Queue _snode_data_queue;
     SEEL_Default_Queue<uint8_t> _bcast_blacklist;
     user_callback_load_t _user_cb_load;
     user_callback_forwarding_t _user_cb_forwarding;
+    SEEL_Scheduler::SEEL_Task_Handle _force_sleep_handle; // Cancelled once the bcast is received
+    SEEL_Scheduler::SEEL_Task_Handle _sleep_handle; // Scheduled once the bcast is received
+#if SEEL_EARLY_SLEEP_ENABLE
+    SEEL_Child _children[SEEL_EARLY_SLEEP_MAX_CHILDREN];
+    uint32_t _sleep_due_millis; // millis() the sleep task is scheduled for
+    uint32_t _bcast_sent_millis; // millis() the bcast was forwarded, children are timed from here
+    uint32_t _early_sleep_millis; // Awake time skipped by the last early sleep, added to the sleep time
+    uint8_t _child_count;
+    bool _children_overflow; // A child did not fit into _children this cycle
+    bool _early_sleep_armed; // Set once the bcast is forwarded and _bcast_sent_millis is valid
+#endif // SEEL_EARLY_SLEEP_ENABLE
     uint32_t _snode_awake_time_secs; // How long node should be awake for, set with bcast
     uint32_t _snode_sleep_time_secs; // How long node should sleep for, set with bcast
     uint32_t _unique_key;
     uint32_t _sleep_time_estimate_millis; // Time estimate for single watch-dog sleep
     uint32_t _sleep_time_offset_millis; // Offset used for future sleeps when SNODE misses broadcast
+    uint32_t _expected_wtb_millis; // WTB expected after the last sleep if the bcast arrives one cycle after the previous one
     uint8_t _missed_bcasts;
+#if SEEL_CAD_ENABLE
+    uint8_t _cad_false_detects; // Detections this cycle that did not lead to a bcast
+#endif // SEEL_CAD_ENABLE
     uint8_t _missed_msgs; // Similar to missed bcasts but only reset on non-blacklisted (data-generating) bcasts received
     uint8_t _last_parent;
+    uint8_t _bcast_slot; // TDMA slot the parent forwarded the bcast in last, SEEL_TDMA_SLOTS if unknown
+    uint8_t _wake_shift_hops; // Hops above this SNODE that may forward the bcast a TDMA cycle earlier, see sleep()
     bool _bcast_received; // Set to false on wake-up, set to true on first broadcast received
     bool _parent_sync;  // Set to false on wake-up, set to true on first non-blacklist broadcast received
     bool _system_sync; // Set to false on Snode start-up, set to true on first non-blacklist broadcast received
@@ -9,22 +9,185 @@ File purpose:   See SEEL_Scheduler.h
 
 #include "SEEL_Scheduler.h"
 
-bool SEEL_Scheduler::add_task(SEEL_Task* tf, uint32_t task_delay)
+#if defined(__AVR__)
+#include <avr/sleep.h>
+#endif
+
+SEEL_Scheduler::SEEL_Task_Handle SEEL_Scheduler::add_task(SEEL_Task* tf, uint32_t task_delay)
+{
+    return insert_unit(tf, SEEL_SCHED_ONE_SHOT, task_delay);
+}
+
+SEEL_Scheduler::SEEL_Task_Handle SEEL_Scheduler::add_periodic_task(SEEL_Task* tf, uint32_t period_millis, uint32_t task_delay)
+{
+    return insert_unit(tf, period_millis, task_delay);
+}
+
+bool SEEL_Scheduler::task_active(const SEEL_Task_Handle& handle)
+{
+    return handle_unit(handle) != NULL;
+}
+
+bool SEEL_Scheduler::cancel_task(const SEEL_Task_Handle& handle)
+{
+    SEEL_Sched_Unit* unit = handle_unit(handle);
+    if (unit == NULL)
+    {
+        return false;
+    }
+
+    if (unit->heap_pos == SEEL_SCHED_UNIT_RUNNING)
+    {
+        // Unit is released once the task returns
+        _current_rearm = false;
+    }
+    else
+    {
+        heap_remove(unit->ref_task->get_priority(), unit->heap_pos);
+        free_unit(handle.index);
+    }
+    return true;
+}
+
+bool SEEL_Scheduler::reschedule_task(const SEEL_Task_Handle& handle, uint32_t task_delay)
+{
+    SEEL_Sched_Unit* unit = handle_unit(handle);
+    if (unit == NULL)
+    {
+        return false;
+    }
+
+    if (unit->heap_pos == SEEL_SCHED_UNIT_RUNNING)
+    {
+        rearm_current_task(task_delay);
+    }
+    else
+    {
+        unit->time_to_run = get_millis() + task_delay;
+        unit->delay_millis = task_delay;
+        uint8_t heap = unit->ref_task->get_priority();
+        uint8_t pos = unit->heap_pos;
+        heap_sift_up(heap, pos);
+        heap_sift_down(heap, unit->heap_pos);
+    }
+    return true;
+}
+
+void SEEL_Scheduler::rearm_current_task(uint32_t task_delay)
+{
+    if (_current_task_ptr == NULL)
+    {
+        return;
+    }
+
+    _current_task_ptr->time_to_run = get_millis() + task_delay;
+    _current_task_ptr->delay_millis = task_delay;
+    _current_rearm = true;
+    _current_rearmed = true;
+}
+
+uint64_t SEEL_Scheduler::get_millis()
 {
-    uint32_t tid = assign_task_id();
     uint32_t current_millis = millis();
-    uint32_t time_to_run = current_millis + task_delay;
-    
-    if (time_to_run < current_millis)
+    if (current_millis < _millis_last)
+    {
+        // millis() wrapped around
+        ++_millis_high;
+    }
+    _millis_last = current_millis;
+    return (((uint64_t)_millis_high << 32) | current_millis) + _millis_slept;
+}
+
+SEEL_Scheduler::SEEL_Task_Handle SEEL_Scheduler::insert_unit(SEEL_Task* tf, uint32_t period_millis, uint32_t task_delay)
+{
+    if (_free_count == 0)
     {
-        // Overflow will occur
-        zero_millis_timer();
-        time_to_run = current_millis + task_delay;
+        if (SEEL_Print::enabled(SEEL_LOG_SCHED, SEEL_LOG_LEVEL_ERROR))
+        {
+            SEEL_Print::print(F("SCHEDULER FULL, SIZE: "));
+            SEEL_Print::println(SEEL_SCHED_QUEUE_SIZE);
+        }
+        return SEEL_Task_Handle();
     }
-    
-    SEEL_Sched_Unit u(tf, time_to_run, task_delay, tid);
 
-    return _scheduler_queue.add(u);
+    uint8_t unit_index = _free_units[--_free_count];
+    SEEL_Sched_Unit* unit = &_sched_units[unit_index];
+    unit->ref_task = tf;
+    unit->time_to_run = get_millis() + task_delay;
+    unit->delay_millis = task_delay;
+    unit->task_id = assign_task_id();
+    unit->period_millis = period_millis;
+    heap_insert(unit_index);
+
+    return SEEL_Task_Handle(unit_index, unit->generation);
+}
+
+SEEL_Scheduler::SEEL_Sched_Unit* SEEL_Scheduler::handle_unit(const SEEL_Task_Handle& handle)
+{
+    if (handle.index >= SEEL_SCHED_QUEUE_SIZE)
+    {
+        return NULL;
+    }
+    SEEL_Sched_Unit* unit = &_sched_units[handle.index];
+    if (unit->generation != handle.generation || unit->heap_pos == SEEL_SCHED_UNIT_FREE)
+    {
+        return NULL;
+    }
+    return unit;
+}
+
+void SEEL_Scheduler::free_unit(uint8_t unit_index)
+{
+    SEEL_Sched_Unit* unit = &_sched_units[unit_index];
+    ++unit->generation;
+    unit->heap_pos = SEEL_SCHED_UNIT_FREE;
+    _free_units[_free_count++] = unit_index;
+}
+
+bool SEEL_Scheduler::add_event_task(SEEL_Task* tf, uint8_t event)
+{
+    if (event >= SEEL_SCHED_EVENT_COUNT || (_event_tasks[event] != NULL && _event_tasks[event] != tf))
+    {
+        if (SEEL_Print::enabled(SEEL_LOG_SCHED, SEEL_LOG_LEVEL_ERROR))
+        {
+            SEEL_Print::print(F("SCHEDULER EVENT TAKEN: "));
+            SEEL_Print::println(event);
+        }
+        return false;
+    }
+
+    _event_tasks[event] = tf;
+    return true;
+}
+
+void SEEL_Scheduler::clear_tasks(bool include_user)
+{
+    for (uint8_t h = 0; h < SEEL_SCHED_HEAP_COUNT; ++h)
+    {
+        if (h == SEEL_SCHED_HEAP_USER && !include_user)
+        {
+            continue;
+        }
+        for (uint8_t i = 0; i < _sched_heap_sizes[h]; ++i)
+        {
+            free_unit(_sched_heaps[h][i]);
+        }
+        _sched_heap_sizes[h] = 0;
+    }
+
+    for (uint8_t e = 0; e < SEEL_SCHED_EVENT_COUNT; ++e)
+    {
+        _event_tasks[e] = NULL;
+    }
+    // Single byte store, atomic without a critical section; leaves the caller's interrupt state alone
+    // (the constructor runs during static initialization, before interrupts may be enabled)
+    _pending_events = 0;
+
+    // Running task is not scheduled again
+    if (_current_task_ptr != NULL && (include_user || !_current_task_ptr->ref_task->get_user_status()))
+    {
+        _current_rearm = false;
+    }
 }
 
 bool SEEL_Scheduler::get_task_info(uint32_t* ret_task_start_time, uint32_t* ret_task_delay, uint32_t* ret_task_id)
@@ -34,78 +197,152 @@ bool SEEL_Scheduler::get_task_info(uint32_t* ret_task_start_time, uint32_t* ret_
         return false;
     }
 
-    *ret_task_start_time = _current_task_ptr->time_to_run;
+    *ret_task_start_time = (uint32_t)_current_task_ptr->time_to_run;
     *ret_task_delay = _current_task_ptr->delay_millis;
     *ret_task_id = _current_task_ptr->task_id;
     return true;
 }
 
-void SEEL_Scheduler::offset_task_times(int32_t offset_millis)
+bool SEEL_Scheduler::unit_before(uint8_t a, uint8_t b)
 {
-    uint32_t current_millis = millis();
-    for (uint32_t i = 0; i < _scheduler_queue.size(); ++i)
+    const SEEL_Sched_Unit& ua = _sched_units[a];
+    const SEEL_Sched_Unit& ub = _sched_units[b];
+    if (ua.time_to_run != ub.time_to_run)
     {
-        uint32_t ttr = _scheduler_queue.front()->time_to_run + offset_millis;
-        
-        if (offset_millis > 0 && ttr < current_millis)
+        return ua.time_to_run < ub.time_to_run;
+    }
+    // Task ids are assigned in add order; compare as signed difference to survive counter wraparound
+    return (int32_t)(ua.task_id - ub.task_id) < 0;
+}
+
+void SEEL_Scheduler::heap_set(uint8_t heap, uint8_t pos, uint8_t unit_index)
+{
+    _sched_heaps[heap][pos] = unit_index;
+    _sched_units[unit_index].heap_pos = pos;
+}
+
+void SEEL_Scheduler::heap_sift_up(uint8_t heap, uint8_t pos)
+{
+    uint8_t* h = _sched_heaps[heap];
+    uint8_t unit_index = h[pos];
+    while (pos > 0)
+    {
+        uint8_t parent = (pos - 1) / 2;
+        if (!unit_before(unit_index, h[parent]))
         {
-            // Overflow has occurred
-            zero_millis_timer();
-            _scheduler_queue.front()->time_to_run += offset_millis;
+            break;
         }
-        else
-        {
-            _scheduler_queue.front()->time_to_run = ttr;
-        }            
-        
-        _scheduler_queue.recycle_front();
+        heap_set(heap, pos, h[parent]);
+        pos = parent;
     }
+    heap_set(heap, pos, unit_index);
 }
 
-// Need a function to reset the millis() timer since we do uint comparisons
-// System will likely get un-sync'd on overflow until next cycle
-void SEEL_Scheduler::zero_millis_timer()
-{   
-    uint32_t original_millis = millis();
-    set_millis(0);
-
-    for (uint32_t i = 0; i < _scheduler_queue.size(); ++i)
+void SEEL_Scheduler::heap_sift_down(uint8_t heap, uint8_t pos)
+{
+    uint8_t* h = _sched_heaps[heap];
+    uint8_t size = _sched_heap_sizes[heap];
+    uint8_t unit_index = h[pos];
+    while (true)
     {
-        if (_scheduler_queue.front()->time_to_run < original_millis)
+        uint8_t smallest = pos;
+        uint8_t smallest_index = unit_index;
+        uint8_t left = 2 * pos + 1;
+        uint8_t right = left + 1;
+        if (left < size && unit_before(h[left], smallest_index))
         {
-            // Task is overdue to run
-            _scheduler_queue.front()->time_to_run = 0;
+            smallest = left;
+            smallest_index = h[left];
         }
-        else
+        if (right < size && unit_before(h[right], smallest_index))
+        {
+            smallest = right;
+            smallest_index = h[right];
+        }
+        if (smallest == pos)
         {
-            _scheduler_queue.front()->time_to_run -= original_millis;
+            break;
         }
-        _scheduler_queue.recycle_front();
+        heap_set(heap, pos, smallest_index);
+        pos = smallest;
     }
+    heap_set(heap, pos, unit_index);
 }
 
-void SEEL_Scheduler::adjust_time(uint32_t new_millis)
+void SEEL_Scheduler::heap_insert(uint8_t unit_index)
 {
-    uint32_t old_millis = millis();
+    uint8_t heap = _sched_units[unit_index].ref_task->get_priority();
+    uint8_t pos = _sched_heap_sizes[heap]++;
+    _sched_heaps[heap][pos] = unit_index;
+    heap_sift_up(heap, pos);
+}
 
-    set_millis(new_millis);
+void SEEL_Scheduler::heap_remove(uint8_t heap, uint8_t pos)
+{
+    uint8_t* h = _sched_heaps[heap];
+    uint8_t last = --_sched_heap_sizes[heap];
+    if (pos != last)
+    {
+        // Move the last unit into the gap, it may belong above or below it
+        uint8_t moved = h[last];
+        h[pos] = moved;
+        heap_sift_up(heap, pos);
+        heap_sift_down(heap, _sched_units[moved].heap_pos);
+    }
+}
 
-    // Correct times in Scheduler with updated times
-    // Note: Large time jumps (a difference bigger than int32_max) may cause tasks to run earlier than scheduled
-    SEEL_Assert::assert(((int64_t)new_millis - (int64_t)old_millis) >= INT32_MIN &&
-        ((int64_t)new_millis - (int64_t)old_millis) <= INT32_MAX, SEEL_ASSERT_FILE_NUM_SCHEDULER, __LINE__);
-    offset_task_times((int32_t)new_millis - (int32_t)old_millis);
+bool SEEL_Scheduler::heap_ready(uint8_t heap, uint64_t current_time)
+{
+    if (_sched_heap_sizes[heap] == 0)
+    {
+        return false;
+    }
+    if (heap != SEEL_SCHED_HEAP_USER)
+    {
+        return true;
+    }
+    // User tasks only run when enabled
+    if (!_user_task_enable)
+    {
+        return false;
+    }
+    // Defer user tasks that could still be running when the next critical task is due
+    if (_sched_heap_sizes[SEEL_SCHED_HEAP_CRITICAL] > 0)
+    {
+        SEEL_Sched_Unit& user = _sched_units[_sched_heaps[SEEL_SCHED_HEAP_USER][0]];
+        uint64_t critical_time = _sched_units[_sched_heaps[SEEL_SCHED_HEAP_CRITICAL][0]].time_to_run;
+        uint64_t user_start = max(user.time_to_run, current_time);
+        return user_start + user.ref_task->get_budget_millis() <= critical_time;
+    }
+    return true;
 }
 
-void SEEL_Scheduler::set_millis(uint32_t new_millis)
+uint8_t SEEL_Scheduler::next_heap(uint64_t current_time)
 {
-    // disables interrupts so no reads/writes can occur in the middle of writing to timer0
-    cli();
- 
-    timer0_millis = new_millis;
- 
-    // re-enable interrupts
-    sei();
+    uint8_t next = SEEL_SCHED_HEAP_COUNT;
+    // Heaps are in priority order, so the first heap with a due task wins
+    for (uint8_t h = 0; h < SEEL_SCHED_HEAP_COUNT; ++h)
+    {
+        if (!heap_ready(h, current_time))
+        {
+            continue;
+        }
+        if (_sched_units[_sched_heaps[h][0]].time_to_run <= current_time)
+        {
+            // Aging: a starved user task goes before system tasks, heap_ready() already kept it clear of critical tasks
+            if (h == SEEL_SCHED_HEAP_SYSTEM && heap_ready(SEEL_SCHED_HEAP_USER, current_time) &&
+                _sched_units[_sched_heaps[SEEL_SCHED_HEAP_USER][0]].time_to_run + SEEL_SCHED_USER_MAX_WAIT_MILLIS <= current_time)
+            {
+                return SEEL_SCHED_HEAP_USER;
+            }
+            return h;
+        }
+        if (next == SEEL_SCHED_HEAP_COUNT || unit_before(_sched_heaps[h][0], _sched_heaps[next][0]))
+        {
+            next = h;
+        }
+    }
+    return next;
 }
 
 void SEEL_Scheduler::run()
@@ -113,25 +350,225 @@ void SEEL_Scheduler::run()
     // Main loop for SEEL (instead of in Arduino's loop() function)
     while (true)
     {
-        uint32_t current_time = millis();
+        dispatch_events();
 
-        // Check if it's time to run the front task
-        _current_task_ptr = _scheduler_queue.front();
-        if (_current_task_ptr != NULL)
+        uint64_t current_time = get_millis();
+#if SEEL_SCHED_STATS_ENABLE
+        ++_stats_loops;
+#endif // SEEL_SCHED_STATS_ENABLE
+
+        // Only the front task of each heap needs to be checked; nothing else in a heap can be due before it
+        uint8_t heap = next_heap(current_time);
+        if (heap != SEEL_SCHED_HEAP_COUNT && _sched_units[_sched_heaps[heap][0]].time_to_run <= current_time)
         {
-            // Run the task if 1) Task is a system task or 2) Task is a user task and user tasks are enabled
-            bool run = (!_current_task_ptr->ref_task->get_user_status() || _user_task_enable);
-            if (_current_task_ptr->time_to_run <= current_time && run)
+            // Unit stays reserved while the task runs, so its handle stays valid and it can be rearmed
+            _current_index = _sched_heaps[heap][0];
+            _current_task_ptr = &_sched_units[_current_index];
+            _current_rearm = (_current_task_ptr->period_millis != SEEL_SCHED_ONE_SHOT);
+            _current_rearmed = false;
+            heap_remove(heap, 0);
+            _current_task_ptr->heap_pos = SEEL_SCHED_UNIT_RUNNING;
+#if SEEL_SCHED_STATS_ENABLE
+            uint32_t lateness_millis = (uint32_t)(current_time - _current_task_ptr->time_to_run);
+            uint32_t start_micros = micros();
+            _current_task_ptr->ref_task->run();
+            record_task_stats(lateness_millis, micros() - start_micros);
+#else
+            _current_task_ptr->ref_task->run();
+#endif // SEEL_SCHED_STATS_ENABLE
+
+            if (_current_rearm)
             {
-                _scheduler_queue.pop_front();
-                _current_task_ptr->ref_task->run();
+                reinsert_current_task();
             }
-            else // Not time to run yet
+            else
             {
-                // Recycle the front task, sending it to the back efficiently
-                _scheduler_queue.recycle_front();
+                free_unit(_current_index);
             }
         }
+        else
+        {
+            idle(heap);
+        }
         _current_task_ptr = NULL;
+        _current_index = SEEL_SCHED_NO_UNIT;
+    }
+}
+
+void SEEL_Scheduler::reinsert_current_task()
+{
+    uint32_t period = _current_task_ptr->period_millis;
+    if (!_current_rearmed && period != SEEL_SCHED_ONE_SHOT)
+    {
+        uint64_t current_millis = get_millis();
+        if (period == 0)
+        {
+            _current_task_ptr->time_to_run = current_millis;
+        }
+        else
+        {
+            // Next run is a whole number of periods after the previous scheduled run, skipping missed runs
+            // Tasks are never overdue by more than 32 bits of millis, so the division stays 32 bit
+            uint64_t ttr = _current_task_ptr->time_to_run;
+            uint32_t elapsed = (current_millis > ttr) ? (uint32_t)(current_millis - ttr) : 0;
+            _current_task_ptr->time_to_run = ttr + (uint64_t)(elapsed / period + 1) * period;
+        }
+        _current_task_ptr->delay_millis = (uint32_t)(_current_task_ptr->time_to_run - current_millis);
+    }
+    heap_insert(_current_index);
+}
+
+void SEEL_Scheduler::dispatch_events()
+{
+    uint8_t events = _pending_events; // Single byte read, atomic
+    if (events == 0)
+    {
+        return;
+    }
+
+    for (uint8_t e = 0; e < SEEL_SCHED_EVENT_COUNT; ++e)
+    {
+        if ((events & (1 << e)) && _event_tasks[e] != NULL)
+        {
+            // Consume the event, it stays pending if no task waits on it
+            cli();
+            _pending_events &= ~(1 << e);
+            sei();
+
+            SEEL_Task* tf = _event_tasks[e];
+            _event_tasks[e] = NULL;
+            bool added = add_task(tf);
+            SEEL_Assert::assert(added, SEEL_ASSERT_FILE_NUM_SCHEDULER, __LINE__);
+        }
+    }
+}
+
+void SEEL_Scheduler::idle(uint8_t heap)
+{
+    bool has_task = (heap != SEEL_SCHED_HEAP_COUNT);
+    uint64_t time_to_run = has_task ? _sched_units[_sched_heaps[heap][0]].time_to_run : 0;
+#if SEEL_SCHED_STATS_ENABLE
+    uint32_t start_micros = micros();
+#endif // SEEL_SCHED_STATS_ENABLE
+
+    while (true)
+    {
+        // Write out deferred log output the stream can take without blocking, TX interrupts wake the loop for more
+        SEEL_Print::drain(false);
+
+        // Check and sleep with interrupts disabled, otherwise an interrupt arriving between the check
+        // and the sleep instruction would go unnoticed until the next wake source
+        cli();
+        if (_wake_pending || (has_task && get_millis() >= time_to_run))
+        {
+            _wake_pending = false;
+            sei();
+#if SEEL_SCHED_STATS_ENABLE
+            _stats_idle_micros += micros() - start_micros;
+            _stats_idle_millis += _stats_idle_micros / 1000;
+            _stats_idle_micros %= 1000;
+#endif // SEEL_SCHED_STATS_ENABLE
+            return;
+        }
+#if SEEL_SCHED_IDLE_ENABLE && defined(__AVR__)
+        set_sleep_mode(SLEEP_MODE_IDLE);
+        sleep_enable();
+        sei(); // Instruction after sei() is guaranteed to run before any pending interrupt
+        sleep_cpu();
+        sleep_disable();
+#else
+        sei();
+        yield();
+#endif
+    }
+}
+
+#if SEEL_SCHED_STATS_ENABLE
+void SEEL_Scheduler::record_task_stats(uint32_t lateness_millis, uint32_t exec_micros)
+{
+    SEEL_Sched_Task_Stats* stats = (SEEL_Sched_Task_Stats*)get_task_stats(_current_task_ptr->ref_task);
+    if (stats == NULL)
+    {
+        if (_task_stats_count >= SEEL_SCHED_STATS_SIZE)
+        {
+            return;
+        }
+        stats = &_task_stats[_task_stats_count++];
+        stats->task = _current_task_ptr->ref_task;
+        stats->dispatches = 0;
+        stats->lateness_max_millis = 0;
+        stats->lateness_sum_millis = 0;
+        stats->exec_max_micros = 0;
+    }
+
+    uint16_t lateness = (lateness_millis > UINT16_MAX) ? UINT16_MAX : lateness_millis;
+    if (stats->dispatches < UINT16_MAX)
+    {
+        ++stats->dispatches;
+        stats->lateness_sum_millis += lateness;
+    }
+    stats->lateness_max_millis = max(stats->lateness_max_millis, lateness);
+    stats->exec_max_micros = max(stats->exec_max_micros, exec_micros);
+}
+
+const SEEL_Scheduler::SEEL_Sched_Task_Stats* SEEL_Scheduler::get_task_stats(const SEEL_Task* tf)
+{
+    for (uint8_t i = 0; i < _task_stats_count; ++i)
+    {
+        if (_task_stats[i].task == tf)
+        {
+            return &_task_stats[i];
+        }
+    }
+    return NULL;
+}
+
+SEEL_Scheduler::SEEL_Sched_Summary SEEL_Scheduler::get_stats_summary()
+{
+    SEEL_Sched_Summary summary;
+    for (uint8_t i = 0; i < _task_stats_count; ++i)
+    {
+        summary.lateness_max_millis = max(summary.lateness_max_millis, _task_stats[i].lateness_max_millis);
+        summary.exec_max_micros = max(summary.exec_max_micros, _task_stats[i].exec_max_micros);
+    }
+
+    uint32_t window_millis = (uint32_t)(get_millis() - _stats_start_millis);
+    if (window_millis > 0)
+    {
+        uint32_t loops_per_sec = (uint64_t)_stats_loops * SEEL_SECS_TO_MILLIS / window_millis;
+        summary.loops_per_sec = (loops_per_sec > UINT16_MAX) ? UINT16_MAX : loops_per_sec;
+        summary.idle_percent = min((uint64_t)_stats_idle_millis * 100 / window_millis, (uint64_t)100);
     }
-}
\ No newline at end of file
+    return summary;
+}
+
+void SEEL_Scheduler::reset_stats()
+{
+    _task_stats_count = 0;
+    _stats_loops = 0;
+    _stats_idle_millis = 0;
+    _stats_idle_micros = 0;
+    _stats_start_millis = get_millis();
+}
+
+void SEEL_Scheduler::print_stats()
+{
+    if (!SEEL_Print::enabled(SEEL_LOG_SCHED, SEEL_LOG_LEVEL_INFO))
+    {
+        return;
+    }
+
+    SEEL_Sched_Summary summary = get_stats_summary();
+    SEEL_Print::print(F("Sched loops/s: ")); SEEL_Print::print(summary.loops_per_sec);
+    SEEL_Print::print(F(", idle %: ")); SEEL_Print::println(summary.idle_percent);
+    for (uint8_t i = 0; i < _task_stats_count; ++i)
+    {
+        const SEEL_Sched_Task_Stats& stats = _task_stats[i];
+        SEEL_Print::print(F("\tTask ")); SEEL_Print::print(i);
+        SEEL_Print::print(F(": runs ")); SEEL_Print::print(stats.dispatches);
+        SEEL_Print::print(F(", late max/mean (ms) ")); SEEL_Print::print(stats.lateness_max_millis);
+        SEEL_Print::print(F("/")); SEEL_Print::print(stats.lateness_mean_millis());
+        SEEL_Print::print(F(", exec max (us) ")); SEEL_Print::println(stats.exec_max_micros);
+    }
+}
+#endif // SEEL_SCHED_STATS_ENABLE
@@ -14,34 +14,152 @@ File purpose:   Task scheduler for user and SEEL tasks. Allows users to insert t
 #include "SEEL_Defines.h"
 #include "SEEL_Task.h"
 
-// For setting system time, affecting the millis() function
-extern volatile uint32_t timer0_millis;
-
 class SEEL_Scheduler
 {
 public:
+    // Structs & Classes
+
+    static const uint8_t SEEL_SCHED_NO_UNIT = UINT8_MAX; // Unit index of invalid handles
+
+    // Refers to a task added to the scheduler, used to cancel or reschedule it
+    // A handle becomes stale once its task has run (one-shot) or is cancelled; stale handles are rejected
+    struct SEEL_Task_Handle
+    {
+        uint8_t index; // Unit index
+        uint8_t generation; // Unit generation when the task was added, changes whenever the unit is freed
+
+        SEEL_Task_Handle() : index(SEEL_SCHED_NO_UNIT), generation(0) {}
+        SEEL_Task_Handle(uint8_t i, uint8_t g) : index(i), generation(g) {}
+
+        // True if the task was successfully added
+        operator bool() const {return index != SEEL_SCHED_NO_UNIT;}
+    };
+#if SEEL_SCHED_STATS_ENABLE
+    // Run statistics of a single task, collected since the last reset_stats()
+    struct SEEL_Sched_Task_Stats
+    {
+        const SEEL_Task* task;
+        uint16_t dispatches;
+        uint16_t lateness_max_millis; // How long after time_to_run the task started
+        uint32_t lateness_sum_millis; // For the mean, see lateness_mean_millis()
+        uint32_t exec_max_micros;
+
+        uint16_t lateness_mean_millis() const {return dispatches > 0 ? lateness_sum_millis / dispatches : 0;}
+    };
+
+    // Compact scheduler summary, reported once per cycle through SEEL_CB_Info
+    struct SEEL_Sched_Summary
+    {
+        uint16_t loops_per_sec; // Scheduler loop passes per second
+        uint16_t lateness_max_millis; // Max lateness over all tasks
+        uint32_t exec_max_micros; // Max run time over all tasks
+        uint8_t idle_percent; // Share of time spent idle waiting for the next task
+
+        SEEL_Sched_Summary() : loops_per_sec(0), lateness_max_millis(0), exec_max_micros(0), idle_percent(0) {}
+    };
+#endif // SEEL_SCHED_STATS_ENABLE
+
     // ***************************************************
     // Member functions
 
     // Constructor
-    SEEL_Scheduler() : _task_counter(0), _user_task_enable(false) {}
+    SEEL_Scheduler() : _free_count(0), _current_task_ptr(NULL), _current_index(SEEL_SCHED_NO_UNIT), _current_rearm(false), _current_rearmed(false),
+        _task_counter(0), _user_task_enable(false), _pending_events(0), _wake_pending(false),
+        _millis_high(0), _millis_last(0), _millis_slept(0), _network_offset(0)
+    {
+        for (uint8_t i = 0; i < SEEL_SCHED_QUEUE_SIZE; ++i)
+        {
+            free_unit(i);
+        }
+        for (uint8_t h = 0; h < SEEL_SCHED_HEAP_COUNT; ++h)
+        {
+            _sched_heap_sizes[h] = 0;
+        }
+        clear_tasks();
+#if SEEL_SCHED_STATS_ENABLE
+        reset_stats();
+#endif // SEEL_SCHED_STATS_ENABLE
+    }
 
     // Returns true if there is a task running and the task is a user task
     // Gives task info via argument pointers if there is a task running and it is a user task
+    // Task start time is the lower 32 bits of the scheduler time, see get_millis()
     bool get_task_info(uint32_t* ret_task_start_time, uint32_t* ret_task_delay, uint32_t* ret_task_id);
 
+    // Returns the scheduler time: millis() extended to 64 bits plus time reported through add_sleep_time(), never wraps or jumps back
+    // Must be called at least once every ~49 days of awake time to catch millis() wraparound; the scheduler loop does this
+    uint64_t get_millis();
+
+    // Advances the scheduler time by "sleep_millis" spent in a sleep that stops millis(), so tasks kept
+    // across the sleep stay on schedule
+    void add_sleep_time(uint32_t sleep_millis) {_millis_slept += sleep_millis;}
+
+    // Returns the network time, the GNODE's millis() as synchronized through bcast msgs
+    uint32_t get_network_millis() {return (uint32_t)get_millis() + _network_offset;}
+
     // Adds one-shot task to the scheduler
     // Calculates the time for the task to run
-    // Returns true if successfully added
-    bool add_task(SEEL_Task* tf, uint32_t task_delay = 0);
+    // Returns a handle to the task, which converts to true if successfully added
+    SEEL_Task_Handle add_task(SEEL_Task* tf, uint32_t task_delay = 0);
+
+    // Adds periodic task to the scheduler, first run is after "task_delay"
+    // Later runs are scheduled from the previous scheduled run time (not when the task finished), so the period does not drift
+    // Runs that were missed entirely are skipped. A period of 0 runs the task on every scheduler pass
+    // Returns a handle to the task, which converts to true if successfully added
+    SEEL_Task_Handle add_periodic_task(SEEL_Task* tf, uint32_t period_millis, uint32_t task_delay = 0);
+
+    // Returns true if "handle" refers to a task that is waiting to run or running
+    bool task_active(const SEEL_Task_Handle& handle);
+
+    // Removes the task from the scheduler; a running task finishes its run but is not scheduled again
+    // Returns false if the handle is stale
+    bool cancel_task(const SEEL_Task_Handle& handle);
+
+    // Moves the task's next run to "task_delay" from now, periodic tasks continue their period from there
+    // Returns false if the handle is stale
+    bool reschedule_task(const SEEL_Task_Handle& handle, uint32_t task_delay);
+
+    // Called from a running task: schedules the task again after "task_delay", keeping its task id and handle
+    // Cheaper than add_task() on itself and cannot fail for lack of space
+    // A periodic task's later runs are scheduled from the new run time
+    void rearm_current_task(uint32_t task_delay = 0);
+
+    // Called from a running periodic task: the task is not scheduled again
+    void stop_current_task() {_current_rearm = false;}
+
+    // Adds one-shot task that is scheduled once "event" (see SEEL_SCHED_EVENT_* in SEEL_Defines.h) is raised
+    // Events raised while no task is waiting are held until a task waits on them, so a task may check
+    // its data source and then wait without missing an event raised in between
+    // Only one task may wait on an event at a time. Returns true if successfully added
+    bool add_event_task(SEEL_Task* tf, uint8_t event);
+
+    // Raises "event", waking the scheduler. Safe to call from ISRs
+    void raise_event(uint8_t event) {_pending_events |= (1 << event); _wake_pending = true;}
 
     // Starts infinite scheduler loop
     void run();
 
+    // Ends the current idle wait early so the scheduler re-checks its tasks
+    // Safe to call from ISRs
+    void wake() {_wake_pending = true;}
+
+#if SEEL_SCHED_STATS_ENABLE
+    // Returns the statistics of "tf", or NULL if "tf" has not run since the last reset_stats() or is not tracked
+    const SEEL_Sched_Task_Stats* get_task_stats(const SEEL_Task* tf);
+
+    // Returns loop rate, idle fraction and max lateness and run time since the last reset_stats()
+    SEEL_Sched_Summary get_stats_summary();
+
+    // Clears all statistics and starts a new measurement window
+    void reset_stats();
+
+    void print_stats();
+#endif // SEEL_SCHED_STATS_ENABLE
+
     // USERS should not call the below public methods unless they know what they're doing
 
-    // Clears all queued tasks in scheduler
-    void clear_tasks() {_scheduler_queue.clear();}
+    // Clears queued tasks and event waits in scheduler, user tasks are kept unless "include_user" is set
+    void clear_tasks(bool include_user = true);
 
     // Return current task counter and increment afterwards
     uint32_t assign_task_id() {return _task_counter++;}
@@ -49,44 +167,124 @@ public:
     // Enable/disable user tasks 
     void set_user_task_enable(bool user_toggle) {_user_task_enable = user_toggle;}
 
-    // If system time shifts, all past scheduler tasks need to have their times altered
-    void offset_task_times(int32_t time_offset_millis);
-    
-    // Millis() overflows in ~50 days; on overflow, tasks can run before they are scheduled
-    // This method handles overflow by setting millis() to 0 and tasks to their relative run times
-    void zero_millis_timer();
-    
-    void adjust_time(uint32_t new_millis);
+    // Sets the network time to "new_network_millis"
+    // Tasks are scheduled against the scheduler time, so they keep their delays and do not need to be updated
+    void adjust_time(uint32_t new_network_millis) {_network_offset = new_network_millis - (uint32_t)get_millis();}
 private:
     // Structs & Classes
+
+    static const uint32_t SEEL_SCHED_ONE_SHOT = UINT32_MAX; // Period of non-periodic tasks
+    static const uint8_t SEEL_SCHED_UNIT_FREE = UINT8_MAX; // heap_pos of units not holding a task
+    static const uint8_t SEEL_SCHED_UNIT_RUNNING = UINT8_MAX - 1; // heap_pos of the running task's unit
     
     // Allows functions and relevant information to scheduling the function to be packaged together
     struct SEEL_Sched_Unit
     {
         // Task function reference
         SEEL_Task* ref_task;
-        // Gets set by system to determine whether to run the task at call
-        uint32_t time_to_run;
+        // Gets set by system to determine whether to run the task at call, in scheduler time
+        uint64_t time_to_run;
         // Delay for tasks that require it
         uint32_t delay_millis;
         // INSTANCE ID used for tracking tasks, for debug use. 
         uint32_t task_id;
+        // Time between runs for periodic tasks, SEEL_SCHED_ONE_SHOT otherwise
+        uint32_t period_millis;
+        // Incremented when the unit is freed, invalidates handles to the unit's previous task
+        uint8_t generation;
+        // Position in its heap, or SEEL_SCHED_UNIT_FREE / SEEL_SCHED_UNIT_RUNNING
+        uint8_t heap_pos;
 
         // Constructors
         SEEL_Sched_Unit()
-        : ref_task(NULL), time_to_run(0), delay_millis(0), task_id(0) {}
-        SEEL_Sched_Unit(SEEL_Task* rt, uint32_t ttr, uint32_t delay, uint32_t tid) 
-        : ref_task(rt), time_to_run(ttr), delay_millis(delay), task_id(tid) {}
+        : ref_task(NULL), time_to_run(0), delay_millis(0), task_id(0), period_millis(SEEL_SCHED_ONE_SHOT), generation(0), heap_pos(SEEL_SCHED_UNIT_FREE) {}
+    };
+
+    // Tasks are split by priority (heap index is the SEEL_Task_Priority) so due tasks are picked by priority
+    // and disabled user tasks never block SEEL tasks
+    enum SEEL_Sched_Heap_Index
+    {
+        SEEL_SCHED_HEAP_CRITICAL = SEEL_Task::PRIORITY_CRITICAL,
+        SEEL_SCHED_HEAP_SYSTEM = SEEL_Task::PRIORITY_SYSTEM,
+        SEEL_SCHED_HEAP_USER = SEEL_Task::PRIORITY_USER,
+        SEEL_SCHED_HEAP_COUNT = 3
     };
 
-    // Sets system time
-    void set_millis(uint32_t new_millis);
+    // ***************************************************
+    // Member functions
+
+
+    // Adds a task to a free unit and places it into the heap matching its task's priority
+    SEEL_Task_Handle insert_unit(SEEL_Task* tf, uint32_t period_millis, uint32_t task_delay);
+
+    // Returns the unit of "handle", or NULL if the handle is stale
+    SEEL_Sched_Unit* handle_unit(const SEEL_Task_Handle& handle);
+
+    // Returns "unit_index" to the free stack
+    void free_unit(uint8_t unit_index);
+
+    // Returns true if unit "a" should run before unit "b". Earlier time_to_run first, ties are FIFO by task id
+    bool unit_before(uint8_t a, uint8_t b);
+
+    // Binary min-heap helpers, heaps store indices into _sched_units
+    void heap_set(uint8_t heap, uint8_t pos, uint8_t unit_index); // Stores a unit at "pos" and records its position
+    void heap_sift_up(uint8_t heap, uint8_t pos);
+    void heap_sift_down(uint8_t heap, uint8_t pos);
+    void heap_insert(uint8_t unit_index);
+    // Removes the unit at "pos" without freeing it
+    void heap_remove(uint8_t heap, uint8_t pos);
+
+    // Returns the heap holding the next task to run, or SEEL_SCHED_HEAP_COUNT if none
+    // Due tasks are picked by priority; if none are due, the heap with the earliest task is returned
+    // User tasks are skipped while disabled or if their budget would overrun the next critical task
+    // A user task overdue by SEEL_SCHED_USER_MAX_WAIT_MILLIS is picked before due system tasks
+    uint8_t next_heap(uint64_t current_time);
+
+    // Returns true if the front task of "heap" is runnable at "current_time"
+    bool heap_ready(uint8_t heap, uint64_t current_time);
+
+    // Moves tasks waiting on raised events into the scheduler
+    void dispatch_events();
+
+    // Schedules the task that just ran again, at its next period or the time set by rearm_current_task()
+    void reinsert_current_task();
+
+#if SEEL_SCHED_STATS_ENABLE
+    // Records a dispatch of the current task that started "lateness_millis" late and ran for "exec_micros"
+    void record_task_stats(uint32_t lateness_millis, uint32_t exec_micros);
+#endif // SEEL_SCHED_STATS_ENABLE
+
+    // Waits in low power idle until the front task of "heap" is due or wake() is called
+    // Waits only for wake() if "heap" is SEEL_SCHED_HEAP_COUNT (no runnable tasks)
+    void idle(uint8_t heap);
 
     // Member variables
-    SEEL_Sched_Queue<SEEL_Sched_Unit> _scheduler_queue;
-    SEEL_Sched_Unit* _current_task_ptr;
+    SEEL_Sched_Unit _sched_units[SEEL_SCHED_QUEUE_SIZE]; // Unit storage, units do not move once added
+    uint8_t _free_units[SEEL_SCHED_QUEUE_SIZE]; // Stack of unused unit indices
+    uint8_t _sched_heaps[SEEL_SCHED_HEAP_COUNT][SEEL_SCHED_QUEUE_SIZE]; // Min-heaps keyed on time_to_run
+    uint8_t _sched_heap_sizes[SEEL_SCHED_HEAP_COUNT];
+    uint8_t _free_count;
+    SEEL_Task* _event_tasks[SEEL_SCHED_EVENT_COUNT]; // Task waiting on each event, NULL if none
+    SEEL_Sched_Unit* _current_task_ptr; // Unit of the running task, the unit stays reserved until the task returns
+    uint8_t _current_index;
+    bool _current_rearm; // Whether the running task is scheduled again once it returns
+    bool _current_rearmed; // Whether the running task set its own next run time with rearm_current_task()
     uint32_t _task_counter;
     bool _user_task_enable;
+    volatile uint8_t _pending_events; // Raised events not yet dispatched, may be written from ISRs
+    volatile bool _wake_pending; // Set by wake() and raise_event(), may be written from ISRs
+    uint32_t _millis_high; // Upper 32 bits of the scheduler time, counts millis() wraparounds
+    uint32_t _millis_last; // millis() at the last get_millis() call, for wraparound detection
+    uint64_t _millis_slept; // Time reported through add_sleep_time()
+    uint32_t _network_offset; // Network time minus the lower 32 bits of the scheduler time
+#if SEEL_SCHED_STATS_ENABLE
+    SEEL_Sched_Task_Stats _task_stats[SEEL_SCHED_STATS_SIZE];
+    uint8_t _task_stats_count;
+    uint32_t _stats_loops; // Scheduler loop passes
+    uint32_t _stats_idle_millis; // Time spent in idle(), whole millis
+    uint32_t _stats_idle_micros; // Time spent in idle(), remainder below a milli
+    uint64_t _stats_start_millis; // Start of the measurement window, in scheduler time
+#endif // SEEL_SCHED_STATS_ENABLE
 };
 
 #endif // SEEL_Scheduler_h
\ No newline at end of file
@@ -15,27 +15,65 @@ File purpose:   SEEL Tasks that can be inserted into the scheduler
 // Users can either pass in a function pointer to SEEL_Task's constructor or 
 // inherit SEEL_Task_h and add custom functions (allows the usage of state variables)
 
+// Stackless coroutine support for SEEL_Task::run() overrides, in the style of protothreads
+// A run() body wrapped in SEEL_CO_BEGIN()/SEEL_CO_END() can suspend with the SEEL_CO_AWAIT_* macros and is resumed
+// at the same point on its next run, instead of polling by re-adding itself
+// Local variables are NOT kept across a suspension, keep state in members. switch statements cannot contain an await
+// "sched" is the SEEL_Scheduler* running the task
+#define SEEL_CO_BEGIN() switch (_co_line) { case 0:
+#define SEEL_CO_END() } _co_line = 0
+
+// Suspends until "cond" is true, re-checking it each time "event" is raised (see SEEL_SCHED_EVENT_* in SEEL_Defines.h)
+// Whatever makes "cond" true should raise "event"
+#define SEEL_CO_AWAIT(sched, cond, event) \
+    do { \
+        _co_line = __LINE__; case __LINE__: \
+        if (!(cond)) {(sched)->add_event_task(this, (event)); return;} \
+    } while (0)
+
+// Suspends for "delay_millis", the task keeps its scheduler unit and handle
+#define SEEL_CO_AWAIT_DELAY(sched, delay_millis) \
+    do { \
+        _co_line = __LINE__; (sched)->rearm_current_task(delay_millis); return; case __LINE__:; \
+    } while (0)
+
 class SEEL_Task
 {
 public:
     // Typedefs
     typedef void (*func_ptr_t)(void);
 
+    // Enums
+
+    // Due tasks run in priority order, ties within a priority run in time order
+    enum SEEL_Task_Priority
+    {
+        PRIORITY_CRITICAL = 0, // Radio timing bound tasks (TDMA send, bcast, sleep)
+        PRIORITY_SYSTEM = 1, // Other SEEL tasks
+        PRIORITY_USER = 2 // Only run when user tasks are enabled, deferred if they could delay a critical task
+    };
+
     // ***************************************************
     // Member functions
 
     // Constructors
     // Default to user_task = true, user tasks should have this as "true" to prevent overriding LoRa tasks
     // Allows for users to pass in function pointer to create a SEEL_Task object
-    SEEL_Task() : _user_task(true), _func(NULL) {}
-    SEEL_Task(func_ptr_t f, bool ut = true) : _user_task(ut), _func(f) {}
+    SEEL_Task() : _priority(PRIORITY_USER), _budget_millis(SEEL_SCHED_USER_BUDGET_MILLIS), _co_line(0), _func(NULL) {}
+    SEEL_Task(func_ptr_t f, bool ut = true) : _priority(ut ? PRIORITY_USER : PRIORITY_SYSTEM), _budget_millis(SEEL_SCHED_USER_BUDGET_MILLIS), _co_line(0), _func(f) {}
 
     // Getters and setters
-    bool get_user_status() { return _user_task; }
+    bool get_user_status() { return _priority == PRIORITY_USER; }
+    SEEL_Task_Priority get_priority() { return _priority; }
+    // Upper bound on the task's run time; user tasks only start if they would finish before the next critical task is due
+    uint16_t get_budget_millis() { return _budget_millis; }
+    void set_budget_millis(uint16_t budget_millis) { _budget_millis = budget_millis; }
     void set_func(func_ptr_t f) { _func = f; }
+    // Restarts a coroutine task from SEEL_CO_BEGIN() on its next run, for tasks cleared from the scheduler while suspended
+    void co_reset() { _co_line = 0; }
 
     // Returns false if the task could not run (no instance)
-    virtual void run() { _func ? _func() : (void)SEEL_Print::println(F("E-F")); } // Error - Function not set
+    virtual void run() { _func ? _func() : (void)(SEEL_Print::enabled(SEEL_LOG_SCHED, SEEL_LOG_LEVEL_ERROR) && SEEL_Print::println(F("E-F"))); } // Error - Function not set
 
     // Destructor
     // Use virtual to call appropriate destructor dynamically
@@ -43,7 +81,9 @@ public:
 
 protected:
     // Member variables
-    bool _user_task;
+    SEEL_Task_Priority _priority;
+    uint16_t _budget_millis;
+    uint16_t _co_line; // Coroutine resume point, 0 to start from SEEL_CO_BEGIN()
 
 private:
     // Member variables
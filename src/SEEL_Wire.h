@@ -0,0 +1,207 @@
+/*
+The SEEL repository can be found at: https://github.com/SEEL-Group/SEEL
+Copyright (C) SEEL Group 2021 all rights reserved
+See license file in root folder for more licensing details
+See SEEL_documentation.pdf for protocol description details
+
+File purpose:   Msg wire format: field constants, compile-time field codec and per-command layouts
+*/
+
+#ifndef SEEL_Wire_h
+#define SEEL_Wire_h
+
+#include <stdint.h>
+
+/*
+This file has no Arduino dependencies so host tools can include it (see misc/seel_wire_host)
+SEEL_MSG_USER_SIZE must be declared before including this file, SEEL_Params.h does so on the NODEs
+Values in this header file should NOT be modified; instead modify values in SEEL_Params.h
+*/
+
+/* MESSAGE COMMANDS */
+const uint8_t SEEL_CMD_BCAST      = 0;
+const uint8_t SEEL_CMD_ACK        = 1;
+const uint8_t SEEL_CMD_DATA       = 2;
+const uint8_t SEEL_CMD_ID_CHECK   = 3;
+
+// Flag bits sent in the cmd field on top of the command, stripped by the receive ISR before msgs are handled
+const uint8_t SEEL_CMD_FLAG_SUBTREE_DONE = 0x80; // DATA/ID_CHECK: sender's subtree has nothing more to send this cycle
+
+/* MESSAGE DESCRIPTION, SIZE in Bytes */
+const uint8_t SEEL_MSG_TARG_INDEX   = 0;
+const uint8_t SEEL_MSG_TARG_SIZE    = 1;
+const uint8_t SEEL_MSG_SEND_INDEX   = 1;
+const uint8_t SEEL_MSG_SEND_SIZE    = 1;
+const uint8_t SEEL_MSG_CMD_INDEX    = 2;
+const uint8_t SEEL_MSG_CMD_SIZE     = 1;
+const uint8_t SEEL_MSG_SEQ_INDEX    = 3;
+const uint8_t SEEL_MSG_SEQ_SIZE     = 1;
+const uint8_t SEEL_MSG_OSEND_INDEX  = 4;
+const uint8_t SEEL_MSG_OSEND_SIZE   = 1;
+const uint8_t SEEL_MSG_MISC_INDEX   = 5;
+const uint8_t SEEL_MSG_MISC_SIZE    = 18;
+const uint8_t SEEL_MSG_USER_INDEX   = 23; // USER_SIZE defined in SEEL_Params.h
+const uint8_t SEEL_MSG_DATA_SIZE = SEEL_MSG_MISC_SIZE + SEEL_MSG_USER_SIZE;
+const uint8_t SEEL_MSG_TOTAL_SIZE = SEEL_MSG_TARG_SIZE + SEEL_MSG_SEND_SIZE + SEEL_MSG_CMD_SIZE
+    + SEEL_MSG_SEQ_SIZE + SEEL_MSG_OSEND_SIZE + SEEL_MSG_MISC_SIZE + SEEL_MSG_USER_SIZE;
+const uint8_t SEEL_MSG_HEADER_SIZE = SEEL_MSG_SEQ_INDEX + SEEL_MSG_SEQ_SIZE; // Fields read before filtering a received msg
+
+/* MESSAGE DATA DESCRIPTION, SIZE in Bytes */
+
+// For CMD: DATA
+// Filled by user
+
+// For CMD: ACK
+// Filled with acknowledgement targets
+
+// For CMD: ID_CHECK
+const uint8_t SEEL_MSG_DATA_ID_CHECK_INDEX = 0;
+const uint8_t SEEL_MSG_DATA_ID_CHECK_SIZE = 1;
+const uint8_t SEEL_MSG_DATA_ID_ENCRYPT_INDEX = 1;
+const uint8_t SEEL_MSG_DATA_ID_ENCRYPT_SIZE = 4;
+
+// For CMD: BCAST
+const uint8_t SEEL_MSG_DATA_FIRST_BCAST_INDEX = 0;
+const uint8_t SEEL_MSG_DATA_FIRST_BCAST_SIZE = 1;
+const uint8_t SEEL_MSG_DATA_BCAST_COUNT_INDEX = 1;
+const uint8_t SEEL_MSG_DATA_BCAST_COUNT_SIZE = 1;
+const uint8_t SEEL_MSG_DATA_TIME_SYNC_INDEX = 2;
+const uint8_t SEEL_MSG_DATA_TIME_SYNC_SIZE = 4;
+const uint8_t SEEL_MSG_DATA_AWAKE_TIME_SECONDS_INDEX = 6;
+const uint8_t SEEL_MSG_DATA_AWAKE_TIME_SECONDS_SIZE = 4;
+const uint8_t SEEL_MSG_DATA_SLEEP_TIME_SECONDS_INDEX = 10;
+const uint8_t SEEL_MSG_DATA_SLEEP_TIME_SECONDS_SIZE = 4;
+const uint8_t SEEL_MSG_DATA_HOP_COUNT_INDEX = 14;
+const uint8_t SEEL_MSG_DATA_HOP_COUNT_SIZE = 1;
+const uint8_t SEEL_MSG_DATA_RSSI_INDEX = 15;
+const uint8_t SEEL_MSG_DATA_RSSI_SIZE = 1;
+const uint8_t SEEL_MSG_DATA_ID_FEEDBACK_INDEX = 16; // Variable size, default is two. Expand with user size
+const uint8_t SEEL_MSG_DATA_ID_FEEDBACK_DEFAULT_SIZE = 2; // Actual size is 2*floor((SEEL_MSG_DATA_ID_FEEDBACK_DEFAULT_SIZE + SEEL_MSG_USER_SIZE) / 2.0)
+const uint8_t SEEL_MSG_DATA_USER_INDEX = 18;  // USER_SIZE defined in SEEL_Params.h
+const uint8_t SEEL_MSG_DATA_ID_FEEDBACK_TOTAL_SIZE = SEEL_MSG_DATA_ID_FEEDBACK_DEFAULT_SIZE + SEEL_MSG_USER_SIZE;
+
+/* WIRE CODEC */
+
+// Big endian (MSB in lower address) integer of "N" bytes, unrolled at compile time
+template <uint8_t N>
+struct SEEL_Wire_BE
+{
+    static inline uint32_t get(const uint8_t* buf)
+    {
+        return (SEEL_Wire_BE<N - 1>::get(buf) << 8) | buf[N - 1];
+    }
+    static inline void set(uint8_t* buf, uint32_t value)
+    {
+        buf[N - 1] = (uint8_t) value;
+        SEEL_Wire_BE<N - 1>::set(buf, value >> 8);
+    }
+};
+
+template <>
+struct SEEL_Wire_BE<0>
+{
+    static inline uint32_t get(const uint8_t*) { return 0; }
+    static inline void set(uint8_t*, uint32_t) {}
+};
+
+// Integer field of "SIZE" (1 to 4) bytes at byte "INDEX" of a buffer
+template <uint8_t INDEX, uint8_t SIZE>
+struct SEEL_Wire_Field
+{
+    static_assert(SIZE >= 1 && SIZE <= 4, "SEEL_Wire_Field holds 1 to 4 bytes, use SEEL_Wire_Bytes for arrays");
+    static constexpr uint8_t index = INDEX;
+    static constexpr uint8_t size = SIZE;
+
+    static inline uint32_t get(const uint8_t* buf) { return SEEL_Wire_BE<SIZE>::get(buf + INDEX); }
+    static inline void set(uint8_t* buf, uint32_t value) { SEEL_Wire_BE<SIZE>::set(buf + INDEX, value); }
+};
+
+// Byte array field of "SIZE" bytes at byte "INDEX" of a buffer
+template <uint8_t INDEX, uint8_t SIZE>
+struct SEEL_Wire_Bytes
+{
+    static constexpr uint8_t index = INDEX;
+    static constexpr uint8_t size = SIZE;
+
+    static inline uint8_t* ptr(uint8_t* buf) { return buf + INDEX; }
+    static inline const uint8_t* ptr(const uint8_t* buf) { return buf + INDEX; }
+};
+
+// Fields listed in wire order; fits() checks that no field overlaps the one before it
+// and that the last one ends within "limit" bytes
+template <typename... Fields>
+struct SEEL_Wire_Layout;
+
+template <>
+struct SEEL_Wire_Layout<>
+{
+    static constexpr bool fits(uint16_t start, uint16_t limit) { return start <= limit; }
+};
+
+template <typename Field, typename... Rest>
+struct SEEL_Wire_Layout<Field, Rest...>
+{
+    static constexpr bool fits(uint16_t start, uint16_t limit)
+    {
+        return Field::index >= start && SEEL_Wire_Layout<Rest...>::fits(Field::index + Field::size, limit);
+    }
+};
+
+/* MESSAGE LAYOUTS */
+
+// Whole msg, in the order fields are sent
+struct SEEL_Wire_Msg
+{
+    typedef SEEL_Wire_Field<SEEL_MSG_TARG_INDEX, SEEL_MSG_TARG_SIZE> Targ_ID;
+    typedef SEEL_Wire_Field<SEEL_MSG_SEND_INDEX, SEEL_MSG_SEND_SIZE> Send_ID;
+    typedef SEEL_Wire_Field<SEEL_MSG_CMD_INDEX, SEEL_MSG_CMD_SIZE> Cmd;
+    typedef SEEL_Wire_Field<SEEL_MSG_SEQ_INDEX, SEEL_MSG_SEQ_SIZE> Seq_Num;
+    typedef SEEL_Wire_Field<SEEL_MSG_OSEND_INDEX, SEEL_MSG_OSEND_SIZE> Orig_Send_ID;
+    typedef SEEL_Wire_Bytes<SEEL_MSG_MISC_INDEX, SEEL_MSG_DATA_SIZE> Data;
+    typedef SEEL_Wire_Layout<Targ_ID, Send_ID, Cmd, Seq_Num, Orig_Send_ID, Data> Layout;
+};
+static_assert(SEEL_Wire_Msg::Layout::fits(0, SEEL_MSG_TOTAL_SIZE), "SEEL msg layout overlaps or exceeds SEEL_MSG_TOTAL_SIZE");
+
+// The layouts below index the data section of a msg (SEEL_Message::data)
+
+// SEEL_CMD_BCAST
+struct SEEL_Wire_Bcast
+{
+    typedef SEEL_Wire_Field<SEEL_MSG_DATA_FIRST_BCAST_INDEX, SEEL_MSG_DATA_FIRST_BCAST_SIZE> First_Bcast;
+    typedef SEEL_Wire_Field<SEEL_MSG_DATA_BCAST_COUNT_INDEX, SEEL_MSG_DATA_BCAST_COUNT_SIZE> Bcast_Count;
+    typedef SEEL_Wire_Field<SEEL_MSG_DATA_TIME_SYNC_INDEX, SEEL_MSG_DATA_TIME_SYNC_SIZE> Time_Sync;
+    typedef SEEL_Wire_Field<SEEL_MSG_DATA_AWAKE_TIME_SECONDS_INDEX, SEEL_MSG_DATA_AWAKE_TIME_SECONDS_SIZE> Awake_Secs;
+    typedef SEEL_Wire_Field<SEEL_MSG_DATA_SLEEP_TIME_SECONDS_INDEX, SEEL_MSG_DATA_SLEEP_TIME_SECONDS_SIZE> Sleep_Secs;
+    typedef SEEL_Wire_Field<SEEL_MSG_DATA_HOP_COUNT_INDEX, SEEL_MSG_DATA_HOP_COUNT_SIZE> Hop_Count;
+    typedef SEEL_Wire_Field<SEEL_MSG_DATA_RSSI_INDEX, SEEL_MSG_DATA_RSSI_SIZE> RSSI;
+    typedef SEEL_Wire_Bytes<SEEL_MSG_DATA_ID_FEEDBACK_INDEX, SEEL_MSG_DATA_ID_FEEDBACK_TOTAL_SIZE> ID_Feedback; // (id, suggested id) pairs
+    typedef SEEL_Wire_Layout<First_Bcast, Bcast_Count, Time_Sync, Awake_Secs, Sleep_Secs, Hop_Count, RSSI, ID_Feedback> Layout;
+};
+static_assert(SEEL_Wire_Bcast::Layout::fits(0, SEEL_MSG_DATA_SIZE), "BCAST layout overlaps or exceeds SEEL_MSG_DATA_SIZE");
+
+// SEEL_CMD_ACK
+struct SEEL_Wire_Ack
+{
+    typedef SEEL_Wire_Bytes<0, SEEL_MSG_DATA_SIZE> Acked_IDs; // Unused bytes are 0
+    typedef SEEL_Wire_Layout<Acked_IDs> Layout;
+};
+static_assert(SEEL_Wire_Ack::Layout::fits(0, SEEL_MSG_DATA_SIZE), "ACK layout overlaps or exceeds SEEL_MSG_DATA_SIZE");
+
+// SEEL_CMD_DATA
+struct SEEL_Wire_Data
+{
+    typedef SEEL_Wire_Bytes<0, SEEL_MSG_DATA_SIZE> User; // Filled by user_callback_load_t
+    typedef SEEL_Wire_Layout<User> Layout;
+};
+static_assert(SEEL_Wire_Data::Layout::fits(0, SEEL_MSG_DATA_SIZE), "DATA layout overlaps or exceeds SEEL_MSG_DATA_SIZE");
+
+// SEEL_CMD_ID_CHECK
+struct SEEL_Wire_ID_Check
+{
+    typedef SEEL_Wire_Field<SEEL_MSG_DATA_ID_CHECK_INDEX, SEEL_MSG_DATA_ID_CHECK_SIZE> ID;
+    typedef SEEL_Wire_Field<SEEL_MSG_DATA_ID_ENCRYPT_INDEX, SEEL_MSG_DATA_ID_ENCRYPT_SIZE> Unique_Key;
+    typedef SEEL_Wire_Layout<ID, Unique_Key> Layout;
+};
+static_assert(SEEL_Wire_ID_Check::Layout::fits(0, SEEL_MSG_DATA_SIZE), "ID_CHECK layout overlaps or exceeds SEEL_MSG_DATA_SIZE");
+
+#endif // SEEL_Wire_h